@@ -0,0 +1,433 @@
+//***************************************************************
+// Channel.h by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Bounded multi-producer/multi-consumer queue for passing data
+// between threads. Try* calls never block and are lock-free
+// (based on D. Vyukov's bounded MPMC queue). Blocking calls
+// go through the lock-free path first and only fall back to
+// sleeping on a condition variable when the channel is full
+// (or empty). Producers and consumers only touch the mutex
+// and the wake-up signals when somebody is actually sleeping,
+// otherwise they only read the waiter count.
+// T must be default constructible and movable.
+//***************************************************************
+
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <condition_variable>
+
+template<class T>
+class Channel
+{
+public:
+	// Capacity is rounded up to the power of two.
+	Channel(size_t capacity);
+
+	// Add an element to the channel. Returns false if the channel is full or closed.
+	bool TryPush(const T &e);
+	bool TryPush(T &&e);
+
+	// Take the oldest element out of the channel. Returns false if the channel is empty.
+	bool TryPop(T *e);
+
+	// Add an element, waiting for free space if needed. Negative 'timeoutMs' means waiting
+	// for as long as it takes. Returns false on timeout or if the channel is closed.
+	bool Push(const T &e, int timeoutMs = -1);
+	bool Push(T &&e, int timeoutMs = -1);
+
+	// Take the oldest element out, waiting for one if needed. Negative 'timeoutMs' means waiting
+	// for as long as it takes. Returns false on timeout or if the channel is closed and empty.
+	bool Pop(T *e, int timeoutMs = -1);
+
+	// Add as many elements from [first, last) as there is space for, claiming all of the
+	// slots at once. Returns the number of elements added. The range is measured before it
+	// is copied, so it has to be a forward range.
+	template<class ForwardIt>
+	size_t TryPushRange(ForwardIt first, ForwardIt last);
+
+	// Take up to 'maxCount' oldest elements out at once and write them to 'out'.
+	// Returns the number of elements taken.
+	template<class OutputIt>
+	size_t TryPopRange(OutputIt out, size_t maxCount);
+
+	// Add all of the elements from [first, last), waiting for free space if needed. 'timeoutMs'
+	// applies to the whole range. Returns the number of elements added, less than the range size
+	// only on timeout or if closed. Like TryPushRange, this needs a forward range.
+	template<class ForwardIt>
+	size_t PushRange(ForwardIt first, ForwardIt last, int timeoutMs = -1);
+
+	// Take between one and 'maxCount' elements out, waiting if the channel is empty.
+	// Returns zero on timeout or if the channel is closed and empty.
+	template<class OutputIt>
+	size_t PopRange(OutputIt out, size_t maxCount, int timeoutMs = -1);
+
+	// Closes the channel. Pushing is no longer possible, popping is possible until the channel
+	// is drained. Wakes up everyone who is waiting.
+	void Close();
+
+	bool IsClosed() const;
+
+	size_t GetCapacity() const;
+
+	// Approximate number of elements in the channel.
+	size_t GetSize() const;
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> mSequence;
+		T mValue;
+	};
+
+	// Claims up to 'maxCount' consecutive cells that are ready. Returns the number of claimed cells.
+	size_t ClaimPush(size_t maxCount, size_t *pos);
+	size_t ClaimPop(size_t maxCount, size_t *pos);
+	// Called after making progress. Wakes up the other side if anybody there is waiting.
+	void Wake(unsigned int &signal, std::atomic<int> &waiters, std::condition_variable &cond);
+
+	// Tries 'tryOp' and sleeps on 'cond' until it succeeds, the channel is closed or the time runs out.
+	// 'signal' is bumped by the other side when it makes progress while somebody is waiting.
+	template<class TryOp>
+	bool WaitFor(TryOp tryOp, unsigned int &signal, std::atomic<int> &waiters, std::condition_variable &cond, int timeoutMs);
+
+	std::vector<Cell> mCells;
+	size_t mMask;
+	std::atomic<bool> mClosed;
+
+	// Counters are kept on separate cache lines so producers and consumers don't fight over them.
+	alignas(64) std::atomic<size_t> mEnqueuePos;
+	alignas(64) std::atomic<size_t> mDequeuePos;
+
+	// Read by every push and pop, but only written when somebody starts or stops waiting.
+	alignas(64) std::atomic<int> mPushWaiters;
+	alignas(64) std::atomic<int> mPopWaiters;
+
+	// Only touched when somebody is waiting. The signals are guarded by the mutex.
+	alignas(64) std::mutex mLock;
+	std::condition_variable mNotEmpty;
+	std::condition_variable mNotFull;
+	unsigned int mPushSignal;
+	unsigned int mPopSignal;
+};
+
+// **************************************************************
+//						Definitions
+// **************************************************************
+
+template<class T>
+inline Channel<T>::Channel(size_t capacity)
+	: mClosed(false)
+	, mEnqueuePos(0)
+	, mDequeuePos(0)
+	, mPushWaiters(0)
+	, mPopWaiters(0)
+	, mPushSignal(0)
+	, mPopSignal(0)
+{
+	size_t size = 2;
+	while (size < capacity) size <<= 1;
+	mCells = std::vector<Cell>(size);
+	mMask = size - 1;
+	for (size_t i = 0; i < size; ++i)
+		mCells[i].mSequence.store(i, std::memory_order_relaxed);
+}
+
+template<class T>
+inline size_t Channel<T>::ClaimPush(size_t maxCount, size_t *pos)
+{
+	if (maxCount == 0 || mClosed.load(std::memory_order_relaxed))
+		return 0;
+
+	size_t p = mEnqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// Count how many consecutive cells are free starting at 'p'.
+		size_t count = 0;
+		bool stale = false;
+		while (count < maxCount && count <= mMask)
+		{
+			size_t seq = mCells[(p + count) & mMask].mSequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(p + count);
+			if (diff == 0)
+				++count;
+			else
+			{
+				// The cell at 'p' being ahead means some other producer already moved on.
+				stale = (diff > 0 && count == 0);
+				break;
+			}
+		}
+
+		if (count == 0 && !stale)
+			return 0; // The channel is full
+
+		if (count != 0 && mEnqueuePos.compare_exchange_weak(p, p + count, std::memory_order_relaxed))
+		{
+			*pos = p;
+			return count;
+		}
+		if (stale)
+			p = mEnqueuePos.load(std::memory_order_relaxed);
+	}
+}
+
+template<class T>
+inline size_t Channel<T>::ClaimPop(size_t maxCount, size_t *pos)
+{
+	if (maxCount == 0)
+		return 0;
+
+	size_t p = mDequeuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// Count how many consecutive cells hold an element starting at 'p'.
+		size_t count = 0;
+		bool stale = false;
+		while (count < maxCount && count <= mMask)
+		{
+			size_t seq = mCells[(p + count) & mMask].mSequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(p + count + 1);
+			if (diff == 0)
+				++count;
+			else
+			{
+				// The cell at 'p' being ahead means some other consumer already moved on.
+				stale = (diff > 0 && count == 0);
+				break;
+			}
+		}
+
+		if (count == 0 && !stale)
+			return 0; // The channel is empty
+
+		if (count != 0 && mDequeuePos.compare_exchange_weak(p, p + count, std::memory_order_relaxed))
+		{
+			*pos = p;
+			return count;
+		}
+		if (stale)
+			p = mDequeuePos.load(std::memory_order_relaxed);
+	}
+}
+
+template<class T>
+inline void Channel<T>::Wake(unsigned int &signal, std::atomic<int> &waiters, std::condition_variable &cond)
+{
+	// Pairs with the fence in WaitFor: either the waiter's retry sees our progress, or we see the waiter.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiters.load(std::memory_order_relaxed) > 0)
+	{
+		std::unique_lock<std::mutex> locker(mLock);
+		++signal;
+		cond.notify_all();
+	}
+}
+
+template<class T>
+inline bool Channel<T>::TryPush(const T &e)
+{
+	T copy(e);
+	return TryPush(std::move(copy));
+}
+
+template<class T>
+inline bool Channel<T>::TryPush(T &&e)
+{
+	size_t pos;
+	if (ClaimPush(1, &pos) == 0)
+		return false;
+
+	Cell &cell = mCells[pos & mMask];
+	cell.mValue = std::move(e);
+	cell.mSequence.store(pos + 1, std::memory_order_release);
+	Wake(mPushSignal, mPopWaiters, mNotEmpty);
+	return true;
+}
+
+template<class T>
+inline bool Channel<T>::TryPop(T *e)
+{
+	size_t pos;
+	if (ClaimPop(1, &pos) == 0)
+		return false;
+
+	Cell &cell = mCells[pos & mMask];
+	*e = std::move(cell.mValue);
+	cell.mSequence.store(pos + mMask + 1, std::memory_order_release);
+	Wake(mPopSignal, mPushWaiters, mNotFull);
+	return true;
+}
+
+template<class T>
+template<class ForwardIt>
+inline size_t Channel<T>::TryPushRange(ForwardIt first, ForwardIt last)
+{
+	size_t pos;
+	size_t count = ClaimPush((size_t)std::distance(first, last), &pos);
+	for (size_t i = 0; i < count; ++i, ++first)
+	{
+		Cell &cell = mCells[(pos + i) & mMask];
+		cell.mValue = *first;
+		cell.mSequence.store(pos + i + 1, std::memory_order_release);
+	}
+	if (count != 0)
+		Wake(mPushSignal, mPopWaiters, mNotEmpty);
+	return count;
+}
+
+template<class T>
+template<class OutputIt>
+inline size_t Channel<T>::TryPopRange(OutputIt out, size_t maxCount)
+{
+	size_t pos;
+	size_t count = ClaimPop(maxCount, &pos);
+	for (size_t i = 0; i < count; ++i)
+	{
+		Cell &cell = mCells[(pos + i) & mMask];
+		*out = std::move(cell.mValue);
+		++out;
+		cell.mSequence.store(pos + i + mMask + 1, std::memory_order_release);
+	}
+	if (count != 0)
+		Wake(mPopSignal, mPushWaiters, mNotFull);
+	return count;
+}
+
+template<class T>
+template<class TryOp>
+inline bool Channel<T>::WaitFor(TryOp tryOp, unsigned int &signal, std::atomic<int> &waiters, std::condition_variable &cond, int timeoutMs)
+{
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while (true)
+	{
+		if (tryOp())
+			return true;
+		if (mClosed.load(std::memory_order_relaxed))
+			return false;
+
+		// Announce the waiter before trying once more. Pairs with the fence in Wake: either the
+		// other side sees the waiter and bumps the signal, or the retry sees its progress.
+		waiters.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		unsigned int seen;
+		{
+			std::unique_lock<std::mutex> locker(mLock);
+			seen = signal;
+		}
+		bool done = tryOp();
+
+		bool timedOut = false;
+		if (!done)
+		{
+			std::unique_lock<std::mutex> locker(mLock);
+			while (signal == seen && !mClosed.load(std::memory_order_relaxed) && !timedOut)
+			{
+				if (timeoutMs < 0)
+					cond.wait(locker);
+				else
+					timedOut = (cond.wait_until(locker, deadline) == std::cv_status::timeout);
+			}
+		}
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+
+		if (done)
+			return true;
+		if (timedOut)
+			return tryOp();
+	}
+}
+
+template<class T>
+inline bool Channel<T>::Push(const T &e, int timeoutMs)
+{
+	T copy(e);
+	return Push(std::move(copy), timeoutMs);
+}
+
+template<class T>
+inline bool Channel<T>::Push(T &&e, int timeoutMs)
+{
+	return WaitFor([this, &e]() { return TryPush(std::move(e)); }, mPopSignal, mPushWaiters, mNotFull, timeoutMs);
+}
+
+template<class T>
+inline bool Channel<T>::Pop(T *e, int timeoutMs)
+{
+	// Consumers are also woken up by Close() but keep on draining until the channel is empty.
+	return WaitFor([this, e]() { return TryPop(e); }, mPushSignal, mPopWaiters, mNotEmpty, timeoutMs);
+}
+
+template<class T>
+template<class ForwardIt>
+inline size_t Channel<T>::PushRange(ForwardIt first, ForwardIt last, int timeoutMs)
+{
+	// Every wait gets only what is left of the time for the whole range
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	size_t total = 0;
+	while (first != last)
+	{
+		int leftMs = timeoutMs;
+		if (timeoutMs >= 0)
+		{
+			auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			leftMs = (left.count() > 0) ? (int)left.count() : 0;
+		}
+
+		size_t count = 0;
+		auto tryOp = [this, &first, &last, &count]() { count = TryPushRange(first, last); return count != 0; };
+		if (!WaitFor(tryOp, mPopSignal, mPushWaiters, mNotFull, leftMs))
+			break;
+		std::advance(first, count);
+		total += count;
+	}
+	return total;
+}
+
+template<class T>
+template<class OutputIt>
+inline size_t Channel<T>::PopRange(OutputIt out, size_t maxCount, int timeoutMs)
+{
+	size_t count = 0;
+	auto tryOp = [this, &out, maxCount, &count]() { count = TryPopRange(out, maxCount); return count != 0; };
+	WaitFor(tryOp, mPushSignal, mPopWaiters, mNotEmpty, timeoutMs);
+	return count;
+}
+
+template<class T>
+inline void Channel<T>::Close()
+{
+	std::unique_lock<std::mutex> locker(mLock);
+	mClosed.store(true, std::memory_order_relaxed);
+	mNotEmpty.notify_all();
+	mNotFull.notify_all();
+}
+
+template<class T>
+inline bool Channel<T>::IsClosed() const
+{
+	return mClosed.load(std::memory_order_relaxed);
+}
+
+template<class T>
+inline size_t Channel<T>::GetCapacity() const
+{
+	return mMask + 1;
+}
+
+template<class T>
+inline size_t Channel<T>::GetSize() const
+{
+	size_t enqueuePos = mEnqueuePos.load(std::memory_order_relaxed);
+	size_t dequeuePos = mDequeuePos.load(std::memory_order_relaxed);
+	return (enqueuePos > dequeuePos) ? enqueuePos - dequeuePos : 0;
+}
+
+#endif
@@ -0,0 +1,455 @@
+//***************************************************************
+// SharedJobQueue.cpp by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//***************************************************************
+
+#include "SharedJobQueue.h"
+
+#include <chrono>
+#include <climits>
+#include <limits>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+using namespace std;
+
+namespace
+{
+	const uint32_t SHARED_JOB_QUEUE_MAGIC = 0x4a4f4251; // "JOBQ"
+	const size_t CACHE_LINE_SIZE = 64;
+	// The largest slot count that can still be rounded up to the power of two in 32 bits.
+	const uint32_t MAX_SLOT_COUNT = 0x80000000u;
+
+	size_t RoundUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// 'value' must not be larger than MAX_SLOT_COUNT.
+	uint32_t RoundUpToPowerOfTwo(uint32_t value)
+	{
+		uint32_t ret = 1;
+		while (ret < value) ret <<= 1;
+		return ret;
+	}
+
+	// Futexes are used without the FUTEX_PRIVATE_FLAG because the words are shared between processes.
+	int Futex(atomic<uint32_t> *word, int op, uint32_t val, const timespec *timeout)
+	{
+		return (int)syscall(SYS_futex, reinterpret_cast<uint32_t *>(word), op, val, timeout, nullptr, 0);
+	}
+
+	// Time left until the deadline in milliseconds, rounded up so that a wait doesn't end before
+	// the deadline. Returns 0 once the deadline has passed.
+	int GetRemainingMs(chrono::steady_clock::time_point deadline)
+	{
+		auto now = chrono::steady_clock::now();
+		if (now >= deadline)
+			return 0;
+		return (int)((deadline - now + chrono::milliseconds(1) - chrono::nanoseconds(1)) / chrono::milliseconds(1));
+	}
+}
+
+// Lives at the beginning of the shared region. Counters that are written by
+// different parties are kept on separate cache lines.
+struct SharedJobQueue::Header
+{
+	atomic<uint32_t> mMagic;
+	uint32_t mSlotCount;
+	uint32_t mSlotSize;
+	uint32_t mSlotStride;
+
+	alignas(CACHE_LINE_SIZE) atomic<uint64_t> mEnqueuePos;
+	alignas(CACHE_LINE_SIZE) atomic<uint64_t> mDequeuePos;
+
+	// Bumped whenever a job is published. Consumers sleep on it.
+	alignas(CACHE_LINE_SIZE) atomic<uint32_t> mJobsSignal;
+	atomic<uint32_t> mJobsWaiters;
+
+	// Bumped whenever a slot is released. Producers sleep on it.
+	alignas(CACHE_LINE_SIZE) atomic<uint32_t> mSpaceSignal;
+	atomic<uint32_t> mSpaceWaiters;
+};
+
+// Precedes the payload of every slot in the ring.
+struct SharedJobQueue::SlotHeader
+{
+	// Sequence number of the slot (see D. Vyukov's bounded MPMC queue). Equal to the
+	// position when the slot is free for the producer at that position and to the
+	// position + 1 when it holds a job for the consumer at that position.
+	atomic<uint64_t> mSequence;
+	uint32_t mJobType;
+	uint32_t mPayloadSize;
+};
+
+SharedJobQueue::SharedJobQueue()
+: mHeader(nullptr),
+mSlots(nullptr),
+mMappedSize(0),
+mFd(-1)
+{
+
+}
+
+SharedJobQueue::~SharedJobQueue()
+{
+	Close();
+}
+
+bool SharedJobQueue::Create(const char *name, uint32_t slotCount, uint32_t slotSize)
+{
+	Close();
+	int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	if (!Map(fd, true, slotCount, slotSize))
+	{
+		close(fd);
+		shm_unlink(name);
+		return false;
+	}
+	return true;
+}
+
+bool SharedJobQueue::CreateAnonymous(uint32_t slotCount, uint32_t slotSize)
+{
+	Close();
+	int fd = (int)syscall(SYS_memfd_create, "SharedJobQueue", 0);
+	if (fd < 0)
+		return false;
+
+	if (!Map(fd, true, slotCount, slotSize))
+	{
+		close(fd);
+		return false;
+	}
+	return true;
+}
+
+bool SharedJobQueue::Open(const char *name)
+{
+	Close();
+	int fd = shm_open(name, O_RDWR, 0600);
+	if (fd < 0)
+		return false;
+
+	if (!Map(fd, false, 0, 0))
+	{
+		close(fd);
+		return false;
+	}
+	return true;
+}
+
+bool SharedJobQueue::OpenFromDescriptor(int fd)
+{
+	Close();
+	int dupFd = dup(fd);
+	if (dupFd < 0)
+		return false;
+
+	if (!Map(dupFd, false, 0, 0))
+	{
+		close(dupFd);
+		return false;
+	}
+	return true;
+}
+
+void SharedJobQueue::Close()
+{
+	if (mHeader)
+		munmap(mHeader, mMappedSize);
+	if (mFd >= 0)
+		close(mFd);
+
+	mHeader = nullptr;
+	mSlots = nullptr;
+	mMappedSize = 0;
+	mFd = -1;
+}
+
+void SharedJobQueue::Unlink(const char *name)
+{
+	shm_unlink(name);
+}
+
+bool SharedJobQueue::IsOpen() const
+{
+	return mHeader != nullptr;
+}
+
+int SharedJobQueue::GetFileDescriptor() const
+{
+	return mFd;
+}
+
+uint32_t SharedJobQueue::GetSlotCount() const
+{
+	return mHeader ? mHeader->mSlotCount : 0;
+}
+
+uint32_t SharedJobQueue::GetSlotSize() const
+{
+	return mHeader ? mHeader->mSlotSize : 0;
+}
+
+bool SharedJobQueue::Map(int fd, bool initialize, uint32_t slotCount, uint32_t slotSize)
+{
+	static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t), "Shared atomics must not carry any extra state.");
+	static_assert(sizeof(atomic<uint32_t>) == sizeof(uint32_t), "Futex words must be plain 32-bit integers.");
+
+	size_t headerSize = RoundUp(sizeof(Header), CACHE_LINE_SIZE);
+	size_t size;
+	if (initialize)
+	{
+		if (slotCount == 0 || slotCount > MAX_SLOT_COUNT)
+			return false;
+		slotCount = RoundUpToPowerOfTwo(slotCount);
+		// The stride is stored in 32 bits and the whole region has to fit in size_t and off_t.
+		if ((uint64_t)sizeof(SlotHeader) + slotSize + CACHE_LINE_SIZE - 1 > UINT32_MAX)
+			return false;
+		size_t slotStride = RoundUp(sizeof(SlotHeader) + slotSize, CACHE_LINE_SIZE);
+		if (slotStride > (SIZE_MAX - headerSize) / slotCount)
+			return false;
+		size = headerSize + slotStride * slotCount;
+		if ((uint64_t)size > (uint64_t)numeric_limits<off_t>::max())
+			return false;
+		if (ftruncate(fd, (off_t)size) != 0)
+			return false;
+	}
+	else
+	{
+		struct stat st;
+		if (fstat(fd, &st) != 0 || (size_t)st.st_size < headerSize)
+			return false;
+		size = (size_t)st.st_size;
+	}
+
+	void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED)
+		return false;
+
+	Header *header = static_cast<Header *>(mem);
+	unsigned char *slots = static_cast<unsigned char *>(mem) + headerSize;
+	if (initialize)
+	{
+		// The memory is zeroed by ftruncate so the atomics only need to be constructed in place.
+		new (header) Header();
+		header->mSlotCount = slotCount;
+		header->mSlotSize = slotSize;
+		header->mSlotStride = (uint32_t)RoundUp(sizeof(SlotHeader) + slotSize, CACHE_LINE_SIZE);
+		header->mEnqueuePos.store(0, memory_order_relaxed);
+		header->mDequeuePos.store(0, memory_order_relaxed);
+		header->mJobsSignal.store(0, memory_order_relaxed);
+		header->mJobsWaiters.store(0, memory_order_relaxed);
+		header->mSpaceSignal.store(0, memory_order_relaxed);
+		header->mSpaceWaiters.store(0, memory_order_relaxed);
+		for (uint32_t i = 0; i < slotCount; ++i)
+		{
+			SlotHeader *slot = new (slots + (size_t)i * header->mSlotStride) SlotHeader();
+			slot->mSequence.store(i, memory_order_relaxed);
+		}
+		// Publish the initialized queue to the processes that are opening it.
+		header->mMagic.store(SHARED_JOB_QUEUE_MAGIC, memory_order_release);
+	}
+	else if (header->mMagic.load(memory_order_acquire) != SHARED_JOB_QUEUE_MAGIC ||
+		header->mSlotCount == 0 || (header->mSlotCount & (header->mSlotCount - 1)) != 0 ||
+		header->mSlotStride < sizeof(SlotHeader) + (size_t)header->mSlotSize ||
+		header->mSlotStride > (size - headerSize) / header->mSlotCount)
+	{
+		munmap(mem, size);
+		return false;
+	}
+
+	mHeader = header;
+	mSlots = slots;
+	mMappedSize = size;
+	mFd = fd;
+	return true;
+}
+
+SharedJobQueue::SlotHeader *SharedJobQueue::GetSlot(uint64_t position) const
+{
+	size_t index = (size_t)(position & (mHeader->mSlotCount - 1));
+	return reinterpret_cast<SlotHeader *>(mSlots + index * mHeader->mSlotStride);
+}
+
+void *SharedJobQueue::BeginPush(uint32_t jobType, uint32_t payloadSize, Reservation *res)
+{
+	if (payloadSize > mHeader->mSlotSize)
+		return nullptr;
+
+	uint64_t pos = mHeader->mEnqueuePos.load(memory_order_relaxed);
+	while (true)
+	{
+		SlotHeader *slot = GetSlot(pos);
+		uint64_t seq = slot->mSequence.load(memory_order_acquire);
+		int64_t diff = (int64_t)seq - (int64_t)pos;
+		if (diff == 0)
+		{ // The slot is free, try to claim it.
+			if (mHeader->mEnqueuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+			{
+				slot->mJobType = jobType;
+				slot->mPayloadSize = payloadSize;
+				res->mPosition = pos;
+				res->mSlot = slot;
+				return slot + 1;
+			}
+		}
+		else if (diff < 0)
+			return nullptr; // The queue is full
+		else
+			pos = mHeader->mEnqueuePos.load(memory_order_relaxed);
+	}
+}
+
+void SharedJobQueue::EndPush(const Reservation &res)
+{
+	SlotHeader *slot = static_cast<SlotHeader *>(res.mSlot);
+	slot->mSequence.store(res.mPosition + 1, memory_order_release);
+	Signal(&mHeader->mJobsSignal, &mHeader->mJobsWaiters);
+}
+
+const void *SharedJobQueue::BeginPop(uint32_t *jobType, uint32_t *payloadSize, Reservation *res)
+{
+	uint64_t pos = mHeader->mDequeuePos.load(memory_order_relaxed);
+	while (true)
+	{
+		SlotHeader *slot = GetSlot(pos);
+		uint64_t seq = slot->mSequence.load(memory_order_acquire);
+		int64_t diff = (int64_t)seq - (int64_t)(pos + 1);
+		if (diff == 0)
+		{ // The slot holds a job, try to claim it.
+			if (mHeader->mDequeuePos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+			{
+				*jobType = slot->mJobType;
+				*payloadSize = slot->mPayloadSize;
+				res->mPosition = pos;
+				res->mSlot = slot;
+				return slot + 1;
+			}
+		}
+		else if (diff < 0)
+			return nullptr; // The queue is empty
+		else
+			pos = mHeader->mDequeuePos.load(memory_order_relaxed);
+	}
+}
+
+void SharedJobQueue::EndPop(const Reservation &res)
+{
+	SlotHeader *slot = static_cast<SlotHeader *>(res.mSlot);
+	slot->mSequence.store(res.mPosition + mHeader->mSlotCount, memory_order_release);
+	Signal(&mHeader->mSpaceSignal, &mHeader->mSpaceWaiters);
+}
+
+bool SharedJobQueue::TryPush(uint32_t jobType, const void *payload, uint32_t payloadSize)
+{
+	Reservation res;
+	void *dst = BeginPush(jobType, payloadSize, &res);
+	if (!dst)
+		return false;
+
+	if (payloadSize > 0)
+		memcpy(dst, payload, payloadSize);
+	EndPush(res);
+	return true;
+}
+
+bool SharedJobQueue::TryPop(uint32_t *jobType, void *buffer, uint32_t bufferSize, uint32_t *payloadSize)
+{
+	// The job is claimed before its size is known so the buffer must fit any job.
+	if (bufferSize < mHeader->mSlotSize)
+		return false;
+
+	Reservation res;
+	const void *src = BeginPop(jobType, payloadSize, &res);
+	if (!src)
+		return false;
+
+	memcpy(buffer, src, *payloadSize);
+	EndPop(res);
+	return true;
+}
+
+bool SharedJobQueue::Push(uint32_t jobType, const void *payload, uint32_t payloadSize, int timeoutMs)
+{
+	if (payloadSize > mHeader->mSlotSize)
+		return false;
+
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+	while (true)
+	{
+		// Read the signal before trying so that a release that happens in between wakes us up.
+		uint32_t signal = mHeader->mSpaceSignal.load(memory_order_acquire);
+		if (TryPush(jobType, payload, payloadSize))
+			return true;
+
+		int remainingMs = -1;
+		if (timeoutMs >= 0)
+		{
+			remainingMs = GetRemainingMs(deadline);
+			if (remainingMs == 0)
+				return false;
+		}
+		Wait(&mHeader->mSpaceSignal, &mHeader->mSpaceWaiters, signal, remainingMs);
+	}
+}
+
+bool SharedJobQueue::Pop(uint32_t *jobType, void *buffer, uint32_t bufferSize, uint32_t *payloadSize, int timeoutMs)
+{
+	// Same check as in TryPop, no wait would make the buffer fit.
+	if (bufferSize < mHeader->mSlotSize)
+		return false;
+
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+	while (true)
+	{
+		// Read the signal before trying so that a publish that happens in between wakes us up.
+		uint32_t signal = mHeader->mJobsSignal.load(memory_order_acquire);
+		if (TryPop(jobType, buffer, bufferSize, payloadSize))
+			return true;
+
+		int remainingMs = -1;
+		if (timeoutMs >= 0)
+		{
+			remainingMs = GetRemainingMs(deadline);
+			if (remainingMs == 0)
+				return false;
+		}
+		Wait(&mHeader->mJobsSignal, &mHeader->mJobsWaiters, signal, remainingMs);
+	}
+}
+
+void SharedJobQueue::Signal(atomic<uint32_t> *futexWord, atomic<uint32_t> *waiters)
+{
+	futexWord->fetch_add(1, memory_order_seq_cst);
+	// Skip the system call when nobody is sleeping.
+	if (waiters->load(memory_order_seq_cst) != 0)
+		Futex(futexWord, FUTEX_WAKE, INT_MAX, nullptr);
+}
+
+bool SharedJobQueue::Wait(atomic<uint32_t> *futexWord, atomic<uint32_t> *waiters, uint32_t expected, int timeoutMs)
+{
+	timespec timeout;
+	timespec *timeoutPt = nullptr;
+	if (timeoutMs >= 0)
+	{
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = (long)(timeoutMs % 1000) * 1000000;
+		timeoutPt = &timeout;
+	}
+
+	waiters->fetch_add(1, memory_order_seq_cst);
+	// Returns immediately if the word has already changed.
+	int ret = Futex(futexWord, FUTEX_WAIT, expected, timeoutPt);
+	waiters->fetch_sub(1, memory_order_seq_cst);
+	return ret == 0;
+}
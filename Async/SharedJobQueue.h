@@ -0,0 +1,115 @@
+//***************************************************************
+// SharedJobQueue.h by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Bounded multi-producer/multi-consumer job queue that lives
+// in shared memory so that several processes on the same
+// machine can exchange jobs without sockets or serialization.
+// Every slot of the ring holds a job type, a payload size and
+// up to 'slotSize' bytes of payload. Producers write payloads
+// directly into the shared ring and consumers read them from
+// there (see BeginPush/BeginPop), so no intermediate copies
+// are made.
+// Blocking calls sleep on futexes placed inside the shared
+// region, which makes this Linux only.
+//***************************************************************
+
+#ifndef SHAREDJOBQUEUE_H
+#define SHAREDJOBQUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+class SharedJobQueue
+{
+public:
+	// Identifies a slot that was reserved with BeginPush/BeginPop
+	// and has to be handed back with EndPush/EndPop.
+	struct Reservation
+	{
+		uint64_t mPosition;
+		void *mSlot;
+	};
+
+public:
+	SharedJobQueue();
+	~SharedJobQueue();
+
+	// Creates a new named queue (shm_open) with 'slotCount' slots (rounded up to
+	// the power of two, at most 2^31) each able to hold 'slotSize' bytes of payload.
+	// Returns false if the queue could not be created or would not fit in memory.
+	bool Create(const char *name, uint32_t slotCount, uint32_t slotSize);
+
+	// Creates a new anonymous queue (memfd_create). The queue can be shared with the
+	// child processes created with fork() or by passing GetFileDescriptor() to
+	// some other process and calling OpenFromDescriptor() there.
+	bool CreateAnonymous(uint32_t slotCount, uint32_t slotSize);
+
+	// Maps an already existing named queue. Returns false on failure.
+	bool Open(const char *name);
+
+	// Maps an already existing queue from the file descriptor. The descriptor is duplicated.
+	bool OpenFromDescriptor(int fd);
+
+	// Unmaps the queue. The shared memory itself lives on until every process
+	// closes it and the name is unlinked.
+	void Close();
+
+	// Removes the name of the named queue from the system.
+	static void Unlink(const char *name);
+
+	// Check whether the queue is mapped.
+	bool IsOpen() const;
+
+	int GetFileDescriptor() const;
+	uint32_t GetSlotCount() const;
+	uint32_t GetSlotSize() const;
+
+	// Reserves a slot for a job with a payload of 'payloadSize' bytes and returns
+	// the pointer into the shared memory where the payload should be written.
+	// Returns null if the queue is full or if the payload does not fit in a slot.
+	// Every successful call must be followed by EndPush.
+	void *BeginPush(uint32_t jobType, uint32_t payloadSize, Reservation *res);
+
+	// Publishes the job reserved with BeginPush to the consumers.
+	void EndPush(const Reservation &res);
+
+	// Reserves the oldest job for reading and returns the pointer to its payload
+	// inside the shared memory. Returns null if the queue is empty.
+	// Every successful call must be followed by EndPop.
+	const void *BeginPop(uint32_t *jobType, uint32_t *payloadSize, Reservation *res);
+
+	// Releases the slot reserved with BeginPop back to the producers.
+	void EndPop(const Reservation &res);
+
+	// Copies the payload into the queue. Returns false if the queue is full.
+	bool TryPush(uint32_t jobType, const void *payload, uint32_t payloadSize);
+
+	// Copies the oldest job into the 'buffer'. Returns false if the queue is empty or if
+	// the 'buffer' is smaller than GetSlotSize().
+	bool TryPop(uint32_t *jobType, void *buffer, uint32_t bufferSize, uint32_t *payloadSize);
+
+	// Same as TryPush but waits until there is free space in the queue.
+	// Negative 'timeoutMs' means waiting for as long as it takes.
+	bool Push(uint32_t jobType, const void *payload, uint32_t payloadSize, int timeoutMs = -1);
+
+	// Same as TryPop but waits until there is a job in the queue. Returns false right away
+	// if the 'buffer' is smaller than GetSlotSize(). Negative 'timeoutMs' means waiting for as long as it takes.
+	bool Pop(uint32_t *jobType, void *buffer, uint32_t bufferSize, uint32_t *payloadSize, int timeoutMs = -1);
+
+private:
+	struct Header;
+	struct SlotHeader;
+
+	bool Map(int fd, bool initialize, uint32_t slotCount, uint32_t slotSize);
+	SlotHeader *GetSlot(uint64_t position) const;
+	void Signal(std::atomic<uint32_t> *futexWord, std::atomic<uint32_t> *waiters);
+	bool Wait(std::atomic<uint32_t> *futexWord, std::atomic<uint32_t> *waiters, uint32_t expected, int timeoutMs);
+
+	Header *mHeader;
+	unsigned char *mSlots;
+	size_t mMappedSize;
+	int mFd;
+};
+
+#endif
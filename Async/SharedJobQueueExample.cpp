@@ -0,0 +1,147 @@
+//***************************************************************
+// SharedJobQueueExample.cpp by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Stand-alone program that exercises SharedJobQueue across
+// processes. The parent creates an anonymous queue for the jobs
+// and one for the results, then starts the consumers with
+// fork() followed by exec() of this same program, so that the
+// children only share the inherited queue descriptors and not
+// the parent's memory. Every consumer adds up the numbers it
+// pops and reports its sum back. Exits with 0 if the sums add
+// up, a nonzero code otherwise.
+// Build: g++ -std=c++11 -O2 SharedJobQueueExample.cpp SharedJobQueue.cpp
+//***************************************************************
+
+#include "SharedJobQueue.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace
+{
+	const uint32_t JOB_NUMBER = 1;
+	const uint32_t JOB_STOP = 2;
+	const uint32_t JOB_SUM = 3;
+
+	const unsigned int CONSUMER_COUNT = 4;
+	const uint64_t JOB_COUNT = 200000;
+	// Small enough for the producer to block on a full queue every now and then.
+	const uint32_t SLOT_COUNT = 64;
+
+	int RunConsumer(int jobsFd, int resultsFd)
+	{
+		SharedJobQueue jobs, results;
+		if (!jobs.OpenFromDescriptor(jobsFd) || !results.OpenFromDescriptor(resultsFd))
+			return 2;
+
+		uint64_t sum = 0;
+		while (true)
+		{
+			uint32_t jobType, payloadSize;
+			uint64_t number;
+			if (!jobs.Pop(&jobType, &number, sizeof(number), &payloadSize))
+				return 3;
+			if (jobType == JOB_STOP)
+				break;
+			if (jobType != JOB_NUMBER || payloadSize != sizeof(number))
+				return 4;
+			sum += number;
+		}
+
+		return results.Push(JOB_SUM, &sum, sizeof(sum)) ? 0 : 5;
+	}
+
+	pid_t StartConsumer(const char *program, int jobsFd, int resultsFd)
+	{
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			char jobsArg[16], resultsArg[16];
+			snprintf(jobsArg, sizeof(jobsArg), "%d", jobsFd);
+			snprintf(resultsArg, sizeof(resultsArg), "%d", resultsFd);
+			execl(program, program, "--consumer", jobsArg, resultsArg, (char *)nullptr);
+			_exit(127);
+		}
+		return pid;
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc == 4 && strcmp(argv[1], "--consumer") == 0)
+		return RunConsumer(atoi(argv[2]), atoi(argv[3]));
+
+	// The descriptors of the anonymous queues are inherited through exec().
+	SharedJobQueue jobs, results;
+	if (!jobs.CreateAnonymous(SLOT_COUNT, sizeof(uint64_t)) || !results.CreateAnonymous(CONSUMER_COUNT, sizeof(uint64_t)))
+	{
+		fprintf(stderr, "Could not create the queues.\n");
+		return 1;
+	}
+
+	// Slot counts past 2^31 can't be rounded up to a power of two in 32 bits.
+	SharedJobQueue tooLarge;
+	if (tooLarge.CreateAnonymous(0x80000001u, 1) || tooLarge.CreateAnonymous(0x80000000u, 0xffffffffu))
+	{
+		fprintf(stderr, "Oversized queue was created.\n");
+		return 1;
+	}
+
+	std::vector<pid_t> consumers;
+	for (unsigned int i = 0; i < CONSUMER_COUNT; ++i)
+	{
+		pid_t pid = StartConsumer(argv[0], jobs.GetFileDescriptor(), results.GetFileDescriptor());
+		if (pid < 0)
+		{
+			fprintf(stderr, "Could not start a consumer.\n");
+			return 1;
+		}
+		consumers.push_back(pid);
+	}
+
+	// Produce the numbers, then one stop job for every consumer.
+	uint64_t expected = 0;
+	for (uint64_t number = 1; number <= JOB_COUNT; ++number)
+	{
+		jobs.Push(JOB_NUMBER, &number, sizeof(number));
+		expected += number;
+	}
+	for (unsigned int i = 0; i < CONSUMER_COUNT; ++i)
+		jobs.Push(JOB_STOP, nullptr, 0);
+
+	bool ok = true;
+	for (pid_t pid : consumers)
+	{
+		int status;
+		if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			fprintf(stderr, "Consumer %d failed.\n", (int)pid);
+			ok = false;
+		}
+	}
+
+	uint64_t total = 0;
+	for (unsigned int i = 0; i < CONSUMER_COUNT; ++i)
+	{
+		uint32_t jobType, payloadSize;
+		uint64_t sum;
+		if (!results.TryPop(&jobType, &sum, sizeof(sum), &payloadSize) || jobType != JOB_SUM)
+		{
+			ok = false;
+			break;
+		}
+		total += sum;
+	}
+
+	if (!ok || total != expected)
+	{
+		fprintf(stderr, "Expected the sum of %llu, got %llu.\n", (unsigned long long)expected, (unsigned long long)total);
+		return 1;
+	}
+	printf("%u consumers processed %llu jobs.\n", CONSUMER_COUNT, (unsigned long long)JOB_COUNT);
+	return 0;
+}
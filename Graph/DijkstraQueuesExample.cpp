@@ -0,0 +1,93 @@
+//***************************************************************
+// DijkstraQueuesExample.cpp by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Stand-alone program that runs Graph::Dijkstra on random
+// graphs with unsigned integer weights, once with the default
+// IndexedPriorityQueue and once with each of the monotone
+// queues (BucketQueue and RadixHeap) plugged in. The same
+// queues are reused between the searches, so they also get
+// emptied and refilled. Exits with 0 if all the distances
+// match, a nonzero code otherwise.
+// Build: g++ -std=c++11 -O2 DijkstraQueuesExample.cpp
+//***************************************************************
+
+#include "Graph.h"
+#include "../PriorityQueue/BucketQueue.h"
+#include "../PriorityQueue/RadixHeap.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const unsigned int GRAPH_COUNT = 50;
+	const unsigned int VERTEX_COUNT = 60;
+	const unsigned int SEARCH_COUNT = 40;
+	const unsigned int MAX_WEIGHT = 16;
+	const unsigned int NO_EDGE = ~0u;
+
+	void BuildRandomGraph(std::mt19937 &random, Graph<int, unsigned int> *graph)
+	{
+		std::uniform_int_distribution<unsigned int> weights(1, MAX_WEIGHT);
+		std::uniform_int_distribution<unsigned int> density(0, 9);
+
+		graph->Clear();
+		for (unsigned int i = 0; i < VERTEX_COUNT; ++i)
+			graph->AddVertex((int)i);
+		for (unsigned int v1 = 0; v1 < VERTEX_COUNT; ++v1)
+			for (unsigned int v2 = v1 + 1; v2 < VERTEX_COUNT; ++v2)
+				if (density(random) == 0)
+					graph->AddEdge(v1, v2, weights(random));
+		graph->UpdateEdges();
+	}
+
+	template<class QueueType>
+	bool CheckSearch(const Graph<int, unsigned int> &graph, unsigned int sI, unsigned int dI,
+		bool expectedFound, unsigned int expectedD, QueueType *queue, const char *queueName)
+	{
+		std::vector<unsigned int> path;
+		unsigned int d = 0;
+		bool found = graph.Dijkstra(sI, dI, &path, &d, queue);
+		if (found != expectedFound || (found && d != expectedD))
+		{
+			fprintf(stderr, "%s: search from %u to %u gave %u, expected %u.\n", queueName, sI, dI,
+				found ? d : NO_EDGE, expectedFound ? expectedD : NO_EDGE);
+			return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	std::mt19937 random(2016);
+	std::uniform_int_distribution<unsigned int> vertices(0, VERTEX_COUNT - 1);
+
+	Graph<int, unsigned int> graph(0, NO_EDGE);
+	BucketQueue<unsigned int> bucketQueue(MAX_WEIGHT, VERTEX_COUNT);
+	RadixHeap<unsigned int> radixHeap(VERTEX_COUNT);
+
+	bool ok = true;
+	for (unsigned int g = 0; g < GRAPH_COUNT; ++g)
+	{
+		BuildRandomGraph(random, &graph);
+		for (unsigned int s = 0; s < SEARCH_COUNT; ++s)
+		{
+			unsigned int sI = vertices(random), dI = vertices(random);
+			if (sI == dI)
+				continue;
+
+			std::vector<unsigned int> path;
+			unsigned int d = 0;
+			bool found = graph.Dijkstra(sI, dI, &path, &d);
+			ok &= CheckSearch(graph, sI, dI, found, d, &bucketQueue, "BucketQueue");
+			ok &= CheckSearch(graph, sI, dI, found, d, &radixHeap, "RadixHeap");
+		}
+	}
+
+	if (!ok)
+		return 1;
+	printf("%u graphs, %u searches per graph, all queues agree.\n", GRAPH_COUNT, SEARCH_COUNT);
+	return 0;
+}
@@ -8,6 +8,8 @@
 #include <cassert>
 #include <vector>
 #include <algorithm>
+#include <functional>
+#include "../PriorityQueue/IndexedPriorityQueue.h"
 
 template<class WeightType>
 struct Edge
@@ -50,6 +52,17 @@ public:
 	// d			- total weight of the found path
 	bool Dijkstra(const VertexType &source, const VertexType &dest, std::vector<unsigned int> *outPath, WeightType *d) const;
 	bool Dijkstra(const unsigned int sI, const unsigned int dI, std::vector<unsigned int> *outPath, WeightType *d) const;
+	// Same as above, but runs on the given min-queue of vertex indices instead of the default IndexedPriorityQueue.
+	// The queue needs the IndexedPriorityQueue interface (e.g. RadixHeap for unsigned integer weights) and
+	// is cleared before use, so the same one can be reused between the searches.
+	template<class QueueType>
+	bool Dijkstra(const unsigned int sI, const unsigned int dI, std::vector<unsigned int> *outPath, WeightType *d, QueueType *toBeCh) const;
+	// Single search from the source that stops once all of the destinations are reached. The paths and
+	// weights are the same as with the single destination version, an empty path meaning that the
+	// destination is not connected. Returns the number of destinations the path was found for.
+	unsigned int Dijkstra(const unsigned int sI, const std::vector<unsigned int> &dIs, std::vector<std::vector<unsigned int>> *outPaths, std::vector<WeightType> *d) const;
+	template<class QueueType>
+	unsigned int Dijkstra(const unsigned int sI, const std::vector<unsigned int> &dIs, std::vector<std::vector<unsigned int>> *outPaths, std::vector<WeightType> *d, QueueType *toBeCh) const;
 
 	// Prim's algorithm, used to generate MST graph. It will return false if all vertices are not connected and true otherwise.
 	// outGraph		- MST graph generated from the input graph
@@ -71,6 +84,11 @@ private:
 	// y must be smaller than x
 	unsigned int GetIndexForCompact(unsigned int x, unsigned int y) const;
 
+	// Dijkstra step shared by the searches: updates the distances of the vertices that are not done yet
+	// through the edges of the just finalized vertex vI, whose distance is vW.
+	template<class QueueType>
+	void RelaxEdges(unsigned int vI, const WeightType &vW, const std::vector<bool> &done, std::vector<int> *predecessors, QueueType *toBeCh) const;
+
 	// Data members
 	std::vector<VertexType> mVertices;
 	std::vector<Edge<WeightType>> mEdges;
@@ -199,6 +217,15 @@ inline bool Graph<VertexType, WeightType>::Dijkstra(const VertexType &source, co
 
 template<class VertexType, class WeightType>
 inline bool Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const unsigned int dI, std::vector<unsigned int> *outPath, WeightType *d) const
+{
+	// Min-queue of the discovered vertices, indexed by the vertex index.
+	IndexedPriorityQueue<WeightType, std::greater<WeightType>> toBeCh(mVertices.size());
+	return Dijkstra(sI, dI, outPath, d, &toBeCh);
+}
+
+template<class VertexType, class WeightType>
+template<class QueueType>
+inline bool Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const unsigned int dI, std::vector<unsigned int> *outPath, WeightType *d, QueueType *toBeCh) const
 {
 	outPath->clear();
 	*d = mMinValue;
@@ -211,30 +238,20 @@ inline bool Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const
 	}
 
 	std::vector<int> predecessors;
-	predecessors.resize(mVertices.size());
-	std::vector<VertexWeight> toBeCh;
-	toBeCh.resize(mVertices.size());
-	for (unsigned int i = 0; i < toBeCh.size(); ++i)
-	{
-		toBeCh[i].vI = i;
-		toBeCh[i].w = mMaxValue;
-		predecessors[i] = -1;
-	}
-	toBeCh[sI].w = mMinValue;
+	predecessors.resize(mVertices.size(), -1);
+	std::vector<bool> done;
+	done.resize(mVertices.size(), false);
 
-	// make heap
-	auto cmp = [](const VertexWeight &left, const VertexWeight &right) { return (left.w) >(right.w); };
-	std::make_heap(toBeCh.begin(), toBeCh.end(), cmp);
+	toBeCh->Clear();
+	toBeCh->Reserve(mVertices.size());
+	toBeCh->Add(sI, mMinValue);
 
-	while (!toBeCh.empty())
+	while (!toBeCh->Empty())
 	{
-		// Remove the root of the min_heap structure (the index with the smallest w).
-		std::pop_heap(toBeCh.begin(), toBeCh.end(), cmp);
-		unsigned int vI = toBeCh.back().vI;
-		WeightType vW = toBeCh.back().w;
-		toBeCh.pop_back();
-		if (vW == mMaxValue)
-			return false; // source and destination are not connected
+		// Remove the vertex with the smallest w.
+		WeightType vW = toBeCh->PeekPriority();
+		unsigned int vI = toBeCh->Remove();
+		done[vI] = true;
 
 		if (vI == dI)
 		{ // destination reached
@@ -250,23 +267,107 @@ inline bool Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const
 			return true;
 		}
 
-		for (unsigned int i = 0; i < toBeCh.size(); ++i)
+		RelaxEdges(vI, vW, done, &predecessors, toBeCh);
+	}
+	return false; // source and destination are not connected
+}
+
+template<class VertexType, class WeightType>
+template<class QueueType>
+inline void Graph<VertexType, WeightType>::RelaxEdges(unsigned int vI, const WeightType &vW, const std::vector<bool> &done, std::vector<int> *predecessors, QueueType *toBeCh) const
+{
+	for (unsigned int uI = 0; uI < mVertices.size(); ++uI)
+	{
+		if (done[uI]) continue; // already finalized (includes vI itself)
+		unsigned int ceI = GetIndexForCompact(std::max(vI, uI), std::min(vI, uI));
+		WeightType edgeW = mEdgesCompact[ceI];
+		if (edgeW == mMaxValue) continue; // vI and uI are not connected
+
+		WeightType uW_new = vW + edgeW;
+		if (!toBeCh->Contains(uI))
 		{
-			unsigned int uI = toBeCh[i].vI;
-			unsigned int ceI = GetIndexForCompact(max(vI, uI), min(vI, uI));
-			WeightType edgeW = mEdgesCompact[ceI];
-			if (edgeW == mMaxValue) continue; // vI and uI are not connected
+			(*predecessors)[uI] = vI;
+			toBeCh->Add(uI, uW_new);
+		}
+		else if (uW_new < toBeCh->GetPriority(uI))
+		{
+			(*predecessors)[uI] = vI;
+			toBeCh->Update(uI, uW_new);
+		}
+	}
+}
 
-			WeightType uW = toBeCh[i].w;
-			WeightType uW_new = vW + edgeW;
-			if (uW_new < uW)
-			{
-				predecessors[uI] = vI;
-				HeapDecreaseKey(toBeCh, uW_new, i);
-			}
+template<class VertexType, class WeightType>
+inline unsigned int Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const std::vector<unsigned int> &dIs, std::vector<std::vector<unsigned int>> *outPaths, std::vector<WeightType> *d) const
+{
+	// Min-queue of the discovered vertices, indexed by the vertex index.
+	IndexedPriorityQueue<WeightType, std::greater<WeightType>> toBeCh(mVertices.size());
+	return Dijkstra(sI, dIs, outPaths, d, &toBeCh);
+}
+
+template<class VertexType, class WeightType>
+template<class QueueType>
+inline unsigned int Graph<VertexType, WeightType>::Dijkstra(const unsigned int sI, const std::vector<unsigned int> &dIs, std::vector<std::vector<unsigned int>> *outPaths, std::vector<WeightType> *d, QueueType *toBeCh) const
+{
+	outPaths->assign(dIs.size(), std::vector<unsigned int>());
+	d->assign(dIs.size(), mMinValue);
+
+	std::vector<int> predecessors;
+	predecessors.resize(mVertices.size(), -1);
+	std::vector<bool> done;
+	done.resize(mVertices.size(), false);
+	std::vector<WeightType> weights;
+	weights.resize(mVertices.size(), mMinValue);
+
+	// Count every destination once, the same one may be asked for more than once.
+	std::vector<bool> isDest;
+	isDest.resize(mVertices.size(), false);
+	unsigned int destsLeft = 0;
+	for (unsigned int dI : dIs)
+	{
+		if (!isDest[dI])
+		{
+			isDest[dI] = true;
+			++destsLeft;
+		}
+	}
+
+	toBeCh->Clear();
+	toBeCh->Reserve(mVertices.size());
+	toBeCh->Add(sI, mMinValue);
+
+	while (!toBeCh->Empty() && destsLeft > 0)
+	{
+		// Remove the vertex with the smallest w.
+		WeightType vW = toBeCh->PeekPriority();
+		unsigned int vI = toBeCh->Remove();
+		done[vI] = true;
+		weights[vI] = vW;
+
+		if (isDest[vI] && --destsLeft == 0)
+			break; // all of the destinations reached
+
+		RelaxEdges(vI, vW, done, &predecessors, toBeCh);
+	}
+
+	// reconstruct the paths to the reached destinations
+	unsigned int found = 0;
+	for (size_t i = 0; i < dIs.size(); ++i)
+	{
+		unsigned int vertI = dIs[i];
+		if (!done[vertI]) continue; // source and destination are not connected
+
+		std::vector<unsigned int> &path = (*outPaths)[i];
+		path.push_back(vertI);
+		while (vertI != sI) // until we arrive at the source
+		{
+			vertI = predecessors[vertI];
+			path.push_back(vertI);
 		}
+		(*d)[i] = weights[dIs[i]];
+		++found;
 	}
-	return false;
+	return found;
 }
 
 template<class VertexType, class WeightType>
@@ -309,7 +410,7 @@ inline bool Graph<VertexType, WeightType>::Prim(const unsigned int sI, Graph<Ver
 		for (unsigned int i = 0; i < toBeCh.size(); ++i)
 		{
 			unsigned int uI = toBeCh[i].vI;
-			unsigned int ceI = GetIndexForCompact(max(vI, uI), min(vI, uI));
+			unsigned int ceI = GetIndexForCompact(std::max(vI, uI), std::min(vI, uI));
 			WeightType edgeW = mEdgesCompact[ceI];
 			if (edgeW == mMaxValue) continue; // vI and uI are not connected
 
@@ -335,7 +436,7 @@ inline bool Graph<VertexType, WeightType>::Prim(const unsigned int sI, Graph<Ver
 		if (i != sI) // root does not have a predecessor
 		{
 			unsigned int pred = predecessors[i];
-			unsigned int ceI = GetIndexForCompact(max(pred, i), min(pred, i));
+			unsigned int ceI = GetIndexForCompact(std::max(pred, i), std::min(pred, i));
 			WeightType edgeW = mEdgesCompact[ceI];
 			outGraph->AddEdge(predecessors[i], i, edgeW);
 		}
@@ -0,0 +1,332 @@
+//***************************************************************
+// PathRequestService.h by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Collects shortest path requests from any number of threads,
+// removes the duplicates and runs them in batches on a pool
+// of workers against a read-only Graph. Results are delivered
+// through futures or callbacks.
+// Since the graph is undirected, requests (a, b) and (b, a)
+// are also treated as duplicates and share the same search.
+// Requests with the same source (the smaller vertex index of
+// the pair) share a single search that stops once all of their
+// destinations are reached.
+// Nothing runs until the requests are flushed, either with
+// Flush() or automatically once enough of them are queued.
+//***************************************************************
+
+#ifndef PATH_REQUEST_SERVICE_H
+#define PATH_REQUEST_SERVICE_H
+
+#include <map>
+#include <memory>
+#include <future>
+#include <exception>
+#include <functional>
+#include "Graph.h"
+#include "../Async/AsyncWorker.h"
+
+template<class VertexType, class WeightType>
+class PathRequestService
+{
+public:
+	struct PathResult
+	{
+		// Whether the path was found at all.
+		bool mFound;
+		// Found path consisting of vertex indices, from the destination to the source (same as Graph::Dijkstra).
+		std::vector<unsigned int> mPath;
+		// Total weight of the found path.
+		WeightType mDistance;
+	};
+
+	// Callbacks are invoked on one of the worker threads. They must not call Flush() or Join(),
+	// nor Request() when the automatic flush is on, since those may wait for the worker itself.
+	// If a callback throws, the rest of the batch still runs and the exception is passed on
+	// to the futures of the same request.
+	typedef std::function<void(const PathResult &)> Callback;
+
+public:
+	// The graph must not be modified while the service is using it.
+	// 'autoFlushCount' is the number of queued requests (duplicates excluded) that flushes them
+	// from within Request(). With 0, the requests only run once Flush() is called.
+	PathRequestService(const Graph<VertexType, WeightType> *graph, unsigned int workerCount, size_t autoFlushCount = 0);
+	~PathRequestService();
+
+	// Queue a request and get the future that will hold the result once the batch it belongs to is done.
+	// Waiting on the future before the request is flushed never returns.
+	std::shared_future<PathResult> Request(unsigned int sI, unsigned int dI);
+
+	// Queue a request and have the callback invoked once the batch it belongs to is done.
+	void Request(unsigned int sI, unsigned int dI, const Callback &callback);
+
+	// Hand all of the queued requests over to the workers. Waits only if the
+	// workers are still busy with the previous batch. Also called by Request()
+	// once the automatic flush count is reached.
+	void Flush();
+
+	// Wait for the workers to finish all of the flushed requests.
+	void Join();
+
+	// Number of requests queued since the last flush, duplicates excluded.
+	size_t GetPendingCount() const;
+
+private:
+	// Everyone who asked for the same (unordered) pair of vertices.
+	struct Pending
+	{
+		Pending() : mForwardUsed(false), mReverseUsed(false) {}
+
+		std::promise<PathResult> mForward;
+		std::promise<PathResult> mReverse;
+		std::shared_future<PathResult> mForwardFuture;
+		std::shared_future<PathResult> mReverseFuture;
+		bool mForwardUsed;
+		bool mReverseUsed;
+		// The second member tells whether the callback asked for the reversed pair.
+		std::vector<std::pair<Callback, bool>> mCallbacks;
+	};
+
+	// All of the requests from the same source, searched for at once.
+	struct Job
+	{
+		unsigned int mSI;
+		std::vector<unsigned int> mDIs;
+		std::vector<std::shared_ptr<Pending>> mPendings;
+	};
+
+	class Worker : public AsyncWorker
+	{
+	public:
+		Worker(const Graph<VertexType, WeightType> *graph) : mGraph(graph), mQueue(graph->GetNumberOfVertices()) {}
+		~Worker() { Join(); }
+
+		// Only touched while the worker is idle.
+		std::vector<Job> mJobs;
+
+	private:
+		virtual void Work();
+		const Graph<VertexType, WeightType> *mGraph;
+		// Reused between the searches.
+		IndexedPriorityQueue<WeightType, std::greater<WeightType>> mQueue;
+		std::vector<std::vector<unsigned int>> mPaths;
+		std::vector<WeightType> mDistances;
+	};
+
+	std::shared_ptr<Pending> &GetPending(unsigned int sI, unsigned int dI, bool *reversed);
+	// Returns whether the automatic flush count has been reached. Called with mPendingLock held.
+	bool ShouldFlush() const;
+
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+	size_t mAutoFlushCount;
+	std::map<std::pair<unsigned int, unsigned int>, std::shared_ptr<Pending>> mPending;
+	mutable std::mutex mPendingLock;
+	std::mutex mFlushLock;
+};
+
+// **************************************************************
+//						Definitions
+// **************************************************************
+
+template<class VertexType, class WeightType>
+inline PathRequestService<VertexType, WeightType>::PathRequestService(const Graph<VertexType, WeightType> *graph, unsigned int workerCount, size_t autoFlushCount)
+	: mAutoFlushCount(autoFlushCount)
+{
+	if (workerCount == 0)
+		workerCount = 1;
+	mWorkers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; ++i)
+		mWorkers.push_back(std::unique_ptr<Worker>(new Worker(graph)));
+}
+
+template<class VertexType, class WeightType>
+inline PathRequestService<VertexType, WeightType>::~PathRequestService()
+{
+	// Nobody should be left waiting for a future that will never be set.
+	Flush();
+	Join();
+}
+
+template<class VertexType, class WeightType>
+inline std::shared_ptr<typename PathRequestService<VertexType, WeightType>::Pending> &
+PathRequestService<VertexType, WeightType>::GetPending(unsigned int sI, unsigned int dI, bool *reversed)
+{
+	*reversed = (sI > dI);
+	std::pair<unsigned int, unsigned int> key = (*reversed) ? std::make_pair(dI, sI) : std::make_pair(sI, dI);
+	std::shared_ptr<Pending> &pending = mPending[key];
+	if (!pending)
+		pending = std::make_shared<Pending>();
+	return pending;
+}
+
+template<class VertexType, class WeightType>
+inline bool PathRequestService<VertexType, WeightType>::ShouldFlush() const
+{
+	return (mAutoFlushCount > 0 && mPending.size() >= mAutoFlushCount);
+}
+
+template<class VertexType, class WeightType>
+inline std::shared_future<typename PathRequestService<VertexType, WeightType>::PathResult>
+PathRequestService<VertexType, WeightType>::Request(unsigned int sI, unsigned int dI)
+{
+	std::shared_future<PathResult> future;
+	bool flush;
+	{
+		std::unique_lock<std::mutex> locker(mPendingLock);
+		bool reversed;
+		Pending &pending = *GetPending(sI, dI, &reversed);
+		if (reversed)
+		{
+			if (!pending.mReverseUsed)
+			{
+				pending.mReverseFuture = pending.mReverse.get_future().share();
+				pending.mReverseUsed = true;
+			}
+			future = pending.mReverseFuture;
+		}
+		else
+		{
+			if (!pending.mForwardUsed)
+			{
+				pending.mForwardFuture = pending.mForward.get_future().share();
+				pending.mForwardUsed = true;
+			}
+			future = pending.mForwardFuture;
+		}
+		flush = ShouldFlush();
+	}
+
+	if (flush)
+		Flush();
+	return future;
+}
+
+template<class VertexType, class WeightType>
+inline void PathRequestService<VertexType, WeightType>::Request(unsigned int sI, unsigned int dI, const Callback &callback)
+{
+	bool flush;
+	{
+		std::unique_lock<std::mutex> locker(mPendingLock);
+		bool reversed;
+		Pending &pending = *GetPending(sI, dI, &reversed);
+		pending.mCallbacks.push_back(std::make_pair(callback, reversed));
+		flush = ShouldFlush();
+	}
+
+	if (flush)
+		Flush();
+}
+
+template<class VertexType, class WeightType>
+inline void PathRequestService<VertexType, WeightType>::Flush()
+{
+	// Only one batch is being handed over at a time.
+	std::unique_lock<std::mutex> flushLocker(mFlushLock);
+
+	std::vector<Job> jobs;
+	{ // Take the whole batch and let the others queue the next one in the meantime.
+		// The pairs are sorted, so the ones with the same source are next to each other.
+		std::unique_lock<std::mutex> locker(mPendingLock);
+		for (auto &p : mPending)
+		{
+			if (jobs.empty() || jobs.back().mSI != p.first.first)
+			{
+				jobs.push_back(Job());
+				jobs.back().mSI = p.first.first;
+			}
+			jobs.back().mDIs.push_back(p.first.second);
+			jobs.back().mPendings.push_back(p.second);
+		}
+		mPending.clear();
+	}
+
+	if (jobs.empty())
+		return;
+
+	// Split the batch evenly between the workers.
+	size_t workerCount = mWorkers.size();
+	size_t begin = 0;
+	for (size_t i = 0; i < workerCount && begin < jobs.size(); ++i)
+	{
+		size_t end = begin + (jobs.size() - begin + (workerCount - i) - 1) / (workerCount - i);
+		Worker &worker = *mWorkers[i];
+		worker.Join();
+		worker.mJobs.assign(jobs.begin() + begin, jobs.begin() + end);
+		worker.Assign(nullptr, 0);
+		begin = end;
+	}
+}
+
+template<class VertexType, class WeightType>
+inline void PathRequestService<VertexType, WeightType>::Join()
+{
+	for (auto &worker : mWorkers)
+		worker->Join();
+}
+
+template<class VertexType, class WeightType>
+inline size_t PathRequestService<VertexType, WeightType>::GetPendingCount() const
+{
+	std::unique_lock<std::mutex> locker(mPendingLock);
+	return mPending.size();
+}
+
+template<class VertexType, class WeightType>
+inline void PathRequestService<VertexType, WeightType>::Worker::Work()
+{
+	for (auto &job : mJobs)
+	{
+		mGraph->Dijkstra(job.mSI, job.mDIs, &mPaths, &mDistances, &mQueue);
+
+		for (size_t i = 0; i < job.mDIs.size(); ++i)
+		{
+			PathResult result;
+			result.mFound = !mPaths[i].empty();
+			result.mPath.swap(mPaths[i]);
+			result.mDistance = mDistances[i];
+
+			// Only make the reversed copy if someone asked for it.
+			Pending &pending = *job.mPendings[i];
+			bool needReversed = pending.mReverseUsed;
+			for (auto &c : pending.mCallbacks)
+				needReversed |= c.second;
+			PathResult reversedResult;
+			if (needReversed)
+			{
+				reversedResult = result;
+				std::reverse(reversedResult.mPath.begin(), reversedResult.mPath.end());
+			}
+
+			// A throwing callback must not leave the futures of the batch waiting forever.
+			std::exception_ptr error;
+			for (auto &c : pending.mCallbacks)
+			{
+				try
+				{
+					c.first(c.second ? reversedResult : result);
+				}
+				catch (...)
+				{
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+			if (pending.mReverseUsed)
+			{
+				if (error)
+					pending.mReverse.set_exception(error);
+				else
+					pending.mReverse.set_value(reversedResult);
+			}
+			if (pending.mForwardUsed)
+			{
+				if (error)
+					pending.mForward.set_exception(error);
+				else
+					pending.mForward.set_value(result);
+			}
+		}
+	}
+	mJobs.clear();
+}
+
+#endif
@@ -0,0 +1,333 @@
+//***************************************************************
+// BucketQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Min-queue for small-range unsigned integer priorities, as
+// used by Dial's algorithm: there is one bucket per priority
+// value and the buckets are reused in a circular fashion, so
+// adding, removing and decreasing a priority take O(1) time.
+// The priorities that are added or updated to may never be
+// smaller than the last removed (or peeked) priority, nor
+// larger than it by more than 'range' (e.g. the largest edge
+// weight of a graph), which holds for Dijkstra-like searches.
+// The elements are dense integer ids, same as with
+// IndexedPriorityQueue, so it can be plugged into
+// Graph::Dijkstra. The ids in a bucket are kept in intrusive
+// linked lists, so nothing is allocated after Reserve.
+//***************************************************************
+
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+
+template <class Priority = unsigned int>
+class BucketQueue
+{
+	static_assert(std::numeric_limits<Priority>::is_integer && !std::numeric_limits<Priority>::is_signed,
+		"BucketQueue needs an unsigned integer priority type.");
+
+public:
+	// Refers to one id in the queue. Stays valid until that id is removed from the queue.
+	// Handles are cheap to copy and any number of them may exist at once.
+	class ElementHandle
+	{
+		friend class BucketQueue<Priority>;
+
+	public:
+		// Creates a handle that doesn't refer to any id.
+		ElementHandle() : mOwnerPt(nullptr), mId(0), mGeneration(0) {}
+
+		// Check whether the id this handle refers to is still in the queue.
+		bool IsValid() const { return (mOwnerPt && mOwnerPt->mGenerations[mId] == mGeneration); }
+
+		// Returns the id this handle refers to.
+		unsigned int GetId() const { return mId; }
+
+		// Returns the priority of the id this handle refers to. The handle must be valid.
+		const Priority& GetPriority() const { return mOwnerPt->mPriorities[mId]; }
+
+		// Changes the priority of the id and then updates the containing queue.
+		// Returns true if successful.
+		// Executes in O(1) time.
+		bool Update(const Priority& priority) { return (IsValid() && mOwnerPt->Update(mId, priority)); }
+
+	private:
+		ElementHandle(BucketQueue<Priority> *ownerPt, unsigned int id)
+			: mOwnerPt(ownerPt), mId(id), mGeneration(ownerPt->mGenerations[id]) {}
+		BucketQueue<Priority> *mOwnerPt;
+		unsigned int mId;
+		unsigned int mGeneration;
+	};
+
+public:
+	// Constructor. 'range' is the largest possible difference between any priority
+	// in the queue and the last removed one, and sets the number of buckets.
+	BucketQueue(Priority range, unsigned int idCount = 0);
+
+	// Reserves space for ids in the range [0, idCount). Larger ids are still
+	// accepted, the arrays simply grow when they are added.
+	void Reserve(unsigned int idCount);
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the queue.
+	size_t Size() const;
+
+	// Check whether the id is in the queue.
+	// Executes in O(1) time.
+	bool Contains(unsigned int id) const;
+
+	// Add an id to the queue with an associated priority and return the handle to it.
+	// If the id is already present, the handle to it is returned and its priority is kept.
+	// Executes in O(1) time.
+	ElementHandle Add(unsigned int id, const Priority& priority);
+
+	// Remove the id with the smallest priority, and return it. The queue must not be empty.
+	// Executes in O(1) amortized time (scans at most 'range' empty buckets).
+	unsigned int Remove();
+
+	// Peek, which returns the id with the smallest priority but does not modify the queue.
+	// The queue must not be empty.
+	// Executes in O(1) amortized time.
+	unsigned int Peek() const;
+
+	// Returns the smallest priority in the queue.
+	// Executes in O(1) amortized time.
+	const Priority& PeekPriority() const;
+
+	// Returns the priority of an id that is in the queue.
+	// Executes in O(1) time.
+	const Priority& GetPriority(unsigned int id) const;
+
+	// Changes the priority of an id that is in the queue, within the same bounds as with Add.
+	// Returns false if the id is not in the queue.
+	// Executes in O(1) time.
+	bool Update(unsigned int id, const Priority& priority);
+
+	// Get a handle to an id in the queue. The handle is not valid if the id is not in the queue.
+	ElementHandle GetElementHandle(unsigned int id);
+
+	// Clears everything in the queue. Only touches the ids that are in the queue.
+	void Clear();
+
+private:
+	// Marks the end of a bucket list
+	static const unsigned int NONE = ~0u;
+	// Stored as the previous id of the ids that are not in the queue
+	static const unsigned int NOT_IN_QUEUE = ~0u - 1;
+
+	size_t GetBucket(const Priority& priority) const;
+	void Link(unsigned int id);
+	void Unlink(unsigned int id);
+	// Moves the cursor forward to the first non-empty bucket. This doesn't change the
+	// contents of the queue, so the const peeks may call it as well.
+	void Advance() const;
+
+private:
+	// First id in each bucket
+	std::vector<unsigned int> mHeads;
+	std::vector<unsigned int> mNext;
+	std::vector<unsigned int> mPrev;
+	std::vector<Priority> mPriorities;
+	// Bumped every time an id leaves the queue, so that the handles to it become invalid
+	std::vector<unsigned int> mGenerations;
+	Priority mRange;
+	// Priority of the bucket under the cursor, never larger than the smallest priority in the queue
+	mutable Priority mCurrent;
+	size_t mSize;
+};
+
+template<class Priority>
+const unsigned int BucketQueue<Priority>::NONE;
+
+template<class Priority>
+const unsigned int BucketQueue<Priority>::NOT_IN_QUEUE;
+
+template<class Priority>
+inline BucketQueue<Priority>::BucketQueue(Priority range, unsigned int idCount)
+	: mHeads((size_t)range + 1, NONE)
+	, mRange(range)
+	, mCurrent(0)
+	, mSize(0)
+{
+	Reserve(idCount);
+}
+
+template<class Priority>
+inline void BucketQueue<Priority>::Reserve(unsigned int idCount)
+{
+	if (idCount > mPrev.size())
+	{
+		mNext.resize(idCount);
+		mPrev.resize(idCount, NOT_IN_QUEUE);
+		mPriorities.resize(idCount);
+		mGenerations.resize(idCount, 0);
+	}
+}
+
+template<class Priority>
+inline size_t BucketQueue<Priority>::GetBucket(const Priority& priority) const
+{
+	return (size_t)(priority % (mRange + (Priority)1));
+}
+
+template<class Priority>
+inline void BucketQueue<Priority>::Link(unsigned int id)
+{
+	// The cursor may have jumped ahead of the last removed priority when the queue was empty.
+	// Moving it back is safe, everything in the queue is still within the range from there.
+	if (mPriorities[id] < mCurrent)
+		mCurrent = mPriorities[id];
+
+	// The cursor may lag behind the smallest priority, move it over the empty buckets
+	// until the new priority fits
+	while (mPriorities[id] > mCurrent + mRange && mHeads[GetBucket(mCurrent)] == NONE)
+		++mCurrent;
+	assert(mPriorities[id] >= mCurrent && mPriorities[id] - mCurrent <= mRange);
+
+	// Push to the front of the bucket list
+	unsigned int& head = mHeads[GetBucket(mPriorities[id])];
+	mNext[id] = head;
+	mPrev[id] = NONE;
+	if (head != NONE)
+		mPrev[head] = id;
+	head = id;
+}
+
+template<class Priority>
+inline void BucketQueue<Priority>::Unlink(unsigned int id)
+{
+	if (mPrev[id] == NONE)
+		mHeads[GetBucket(mPriorities[id])] = mNext[id];
+	else
+		mNext[mPrev[id]] = mNext[id];
+
+	if (mNext[id] != NONE)
+		mPrev[mNext[id]] = mPrev[id];
+}
+
+template<class Priority>
+inline void BucketQueue<Priority>::Advance() const
+{
+	// All of the priorities are within the range from the cursor, so this
+	// visits every bucket at most once. It would never stop on an empty queue.
+	assert(mSize != 0 && "Remove or peek on an empty queue.");
+	while (mHeads[GetBucket(mCurrent)] == NONE)
+		++mCurrent;
+}
+
+template<class Priority>
+inline bool BucketQueue<Priority>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class Priority>
+inline size_t BucketQueue<Priority>::Size() const
+{
+	return mSize;
+}
+
+template<class Priority>
+inline bool BucketQueue<Priority>::Contains(unsigned int id) const
+{
+	return (id < mPrev.size() && mPrev[id] != NOT_IN_QUEUE);
+}
+
+template<class Priority>
+inline typename BucketQueue<Priority>::ElementHandle BucketQueue<Priority>::Add(unsigned int id, const Priority& priority)
+{
+	// Return early if the id is already present
+	if (Contains(id))
+		return ElementHandle(this, id);
+
+	if (id >= mPrev.size())
+		Reserve(id + 1);
+
+	// An empty queue has nothing to keep the cursor where it is, so it jumps straight to the
+	// new priority instead of stepping there one bucket at a time
+	if (mSize == 0)
+		mCurrent = priority;
+	mPriorities[id] = priority;
+	Link(id);
+	++mSize;
+	return ElementHandle(this, id);
+}
+
+template<class Priority>
+inline unsigned int BucketQueue<Priority>::Remove()
+{
+	Advance();
+	unsigned int ret = mHeads[GetBucket(mCurrent)];
+	Unlink(ret);
+	mPrev[ret] = NOT_IN_QUEUE;
+	++mGenerations[ret];
+	--mSize;
+	return ret;
+}
+
+template<class Priority>
+inline unsigned int BucketQueue<Priority>::Peek() const
+{
+	Advance();
+	return mHeads[GetBucket(mCurrent)];
+}
+
+template<class Priority>
+inline const Priority& BucketQueue<Priority>::PeekPriority() const
+{
+	return mPriorities[Peek()];
+}
+
+template<class Priority>
+inline const Priority& BucketQueue<Priority>::GetPriority(unsigned int id) const
+{
+	return mPriorities[id];
+}
+
+template<class Priority>
+inline bool BucketQueue<Priority>::Update(unsigned int id, const Priority& priority)
+{
+	if (!Contains(id))
+		return false;
+
+	// Same as with Add, if this is the only id, the cursor can go wherever it has to
+	Unlink(id);
+	if (mSize == 1)
+		mCurrent = priority;
+	mPriorities[id] = priority;
+	Link(id);
+	return true;
+}
+
+template<class Priority>
+inline typename BucketQueue<Priority>::ElementHandle BucketQueue<Priority>::GetElementHandle(unsigned int id)
+{
+	if (!Contains(id))
+		return ElementHandle();
+	return ElementHandle(this, id);
+}
+
+template<class Priority>
+inline void BucketQueue<Priority>::Clear()
+{
+	for (unsigned int& head : mHeads)
+	{
+		while (head != NONE)
+		{
+			unsigned int id = head;
+			head = mNext[id];
+			mPrev[id] = NOT_IN_QUEUE;
+			++mGenerations[id];
+		}
+	}
+	mCurrent = 0;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,430 @@
+//***************************************************************
+// ExternalPriorityQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Priority queue for more elements than there is memory for.
+// Only a bounded heap is kept in memory. When it fills up, it
+// is sorted and written out as a run to a temporary file, and
+// the runs are read back block by block through a k-way merge
+// of their heads. Every open run holds one block in memory, so
+// half of the memory budget goes to the heap and the other half
+// to the blocks. Once there are as many open runs as there are
+// blocks for them, the smaller half of the runs is merged into
+// one, so the heap and the blocks together never take more than
+// the budget. All of the file access is sequential and done in
+// whole blocks.
+// Elements are written to the files as they are, so T has to
+// be trivially copyable. Like SequenceHeap, there is no value
+// index, so there are no handles and equal elements are all
+// kept. Ordering follows PriorityQueue: with std::less the
+// greatest element is on the top.
+// The temporary files come from std::tmpfile, so they are
+// deleted as soon as they are closed, even after a crash.
+//***************************************************************
+
+#ifndef EXTERNAL_PRIORITY_QUEUE_H
+#define EXTERNAL_PRIORITY_QUEUE_H
+
+#include <vector>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+template <class T, class Compare = std::less<T>>
+class ExternalPriorityQueue
+{
+	static_assert(std::is_trivially_copyable<T>::value, "ExternalPriorityQueue writes the elements to files as they are.");
+
+public:
+	// Constructor. At most 'memoryElements' elements are kept in memory, in the heap and in
+	// the blocks of the runs, and files are read and written in blocks of 'blockElements'
+	// elements. Smaller blocks are used if the budget can't hold six of them. The fewer
+	// blocks there are room for, the fewer runs stay open and the more often they are merged.
+	ExternalPriorityQueue(size_t memoryElements = 1 << 22, size_t blockElements = 1 << 16, const Compare& comp = Compare());
+	~ExternalPriorityQueue();
+
+	ExternalPriorityQueue(const ExternalPriorityQueue&) = delete;
+	ExternalPriorityQueue& operator=(const ExternalPriorityQueue&) = delete;
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the queue, in memory and on disk.
+	size_t Size() const;
+
+	// Number of elements on disk.
+	size_t GetSpilledSize() const;
+
+	// Check whether a temporary file could not be created, written or read. After a failure
+	// nothing more is spilled and new elements stay in memory until the queue is cleared.
+	// When reading fails, the unread elements are lost.
+	bool Failed() const;
+
+	// Add an element to the queue.
+	// Executes in O(log m) time, plus O(log n) amortized sequential I/O per element.
+	void Add(const T& e);
+
+	// Remove the element from the queue that has the highest priority, and return it.
+	// Executes in O(log m + log r) time for r runs, plus the amortized I/O.
+	T Remove();
+
+	// Peek, which returns the highest - priority element but does not modify the queue.
+	// Executes in O(1) time.
+	const T& Peek() const;
+
+	// Clears everything in the queue and deletes the temporary files. Spilling is tried
+	// again after a failure.
+	void Clear();
+
+private:
+	// A sorted run in a temporary file, with the best element first
+	struct Run
+	{
+		FILE *mFile;
+		// Elements in the file that haven't been read into the buffer yet
+		size_t mUnread;
+		std::vector<T> mBuffer;
+		// Position of the head of the run in the buffer
+		size_t mPos;
+	};
+
+	// Writes the in-memory heap into a new run. Returns false if that failed.
+	bool Spill();
+	// Opens a new run over a file that has just been written with 'count' elements.
+	void AddRun(FILE *file, size_t count);
+	// Merges the smaller half of the runs into one if there are no blocks left for another run.
+	void MergeSmallestRuns();
+	// Number of elements left in the run.
+	size_t GetRemaining(const Run& run) const;
+	// Reads the next block of the run into its buffer, or closes the run if there is nothing left.
+	void LoadBlock(Run& run);
+	// Moves the head of the run forward.
+	void Advance(Run& run);
+	bool IsOpen(const Run& run) const;
+	const T& GetHead(const Run& run) const;
+	bool WriteBlock(FILE *file, const T *data, size_t count);
+	void CloseRun(Run& run);
+	// Drops the closed runs and rebuilds the heap of the run heads.
+	void RebuildHeads();
+	// Whether the best run head is better than the top of the in-memory heap.
+	bool RunFirst() const;
+
+private:
+	// Heap ordered by mComp, the best element is at the front
+	std::vector<T> mMemory;
+	std::vector<Run> mRuns;
+	// Indices of the open runs, in a heap by their heads
+	std::vector<size_t> mHeads;
+	size_t mBlockElements;
+	// Size of the in-memory heap, the rest of the budget goes to the blocks
+	size_t mHeapElements;
+	// Number of open runs that get their smaller half merged, one block is kept for the merge itself
+	size_t mMaxRuns;
+	size_t mSize;
+	bool mFailed;
+	Compare mComp;
+};
+
+template<class T, class Compare>
+inline ExternalPriorityQueue<T, Compare>::ExternalPriorityQueue(size_t memoryElements, size_t blockElements, const Compare& comp)
+	: mSize(0)
+	, mFailed(false)
+	, mComp(comp)
+{
+	// Half of the budget for the blocks, which need to be at least three: two runs to merge and the merged one
+	memoryElements = std::max(memoryElements, (size_t)6);
+	mBlockElements = std::max(std::min(blockElements, memoryElements / 6), (size_t)1);
+	size_t blockCount = memoryElements / 2 / mBlockElements;
+	mHeapElements = memoryElements - blockCount * mBlockElements;
+	mMaxRuns = blockCount - 1;
+}
+
+template<class T, class Compare>
+inline ExternalPriorityQueue<T, Compare>::~ExternalPriorityQueue()
+{
+	Clear();
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::IsOpen(const Run& run) const
+{
+	return (run.mFile != nullptr);
+}
+
+template<class T, class Compare>
+inline const T& ExternalPriorityQueue<T, Compare>::GetHead(const Run& run) const
+{
+	return run.mBuffer[run.mPos];
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::CloseRun(Run& run)
+{
+	if (run.mFile)
+		std::fclose(run.mFile);
+	run.mFile = nullptr;
+	run.mUnread = 0;
+	std::vector<T>().swap(run.mBuffer);
+	run.mPos = 0;
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::LoadBlock(Run& run)
+{
+	size_t count = std::min(run.mUnread, mBlockElements);
+	run.mBuffer.resize(count);
+	run.mPos = 0;
+	if (count != 0 && std::fread(run.mBuffer.data(), sizeof(T), count, run.mFile) == count)
+	{
+		run.mUnread -= count;
+		return;
+	}
+
+	// Either the run is done or the file can't be read, the rest of it is gone in both cases
+	if (count != 0)
+	{
+		mFailed = true;
+		mSize -= run.mUnread;
+	}
+	CloseRun(run);
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::Advance(Run& run)
+{
+	if (++run.mPos == run.mBuffer.size())
+		LoadBlock(run);
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::WriteBlock(FILE *file, const T *data, size_t count)
+{
+	return (std::fwrite(data, sizeof(T), count, file) == count);
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::AddRun(FILE *file, size_t count)
+{
+	std::rewind(file);
+	Run run;
+	run.mFile = file;
+	run.mUnread = count;
+	run.mPos = 0;
+	mRuns.push_back(std::move(run));
+	LoadBlock(mRuns.back());
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::RebuildHeads()
+{
+	mRuns.erase(std::remove_if(mRuns.begin(), mRuns.end(), [this](const Run& run) { return !IsOpen(run); }), mRuns.end());
+	mHeads.clear();
+	for (size_t i = 0; i < mRuns.size(); ++i)
+		mHeads.push_back(i);
+	auto headComp = [this](size_t a, size_t b) { return mComp(GetHead(mRuns[a]), GetHead(mRuns[b])); };
+	std::make_heap(mHeads.begin(), mHeads.end(), headComp);
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::Spill()
+{
+	FILE *file = std::tmpfile();
+	if (!file)
+	{
+		mFailed = true;
+		return false;
+	}
+
+	// Best element first, so that the runs are read front to back
+	size_t count = mMemory.size();
+	std::sort(mMemory.begin(), mMemory.end(), [this](const T& a, const T& b) { return mComp(b, a); });
+	for (size_t i = 0; i < mMemory.size(); i += mBlockElements)
+	{
+		if (!WriteBlock(file, &mMemory[i], std::min(mBlockElements, mMemory.size() - i)))
+		{
+			// Keep everything in memory, it only has to be a heap again
+			std::fclose(file);
+			std::make_heap(mMemory.begin(), mMemory.end(), mComp);
+			mFailed = true;
+			return false;
+		}
+	}
+
+	mMemory.clear();
+	AddRun(file, count);
+	MergeSmallestRuns();
+	RebuildHeads();
+	return true;
+}
+
+template<class T, class Compare>
+inline size_t ExternalPriorityQueue<T, Compare>::GetRemaining(const Run& run) const
+{
+	return (run.mUnread + run.mBuffer.size() - run.mPos);
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::MergeSmallestRuns()
+{
+	std::vector<size_t> heads;
+	for (size_t i = 0; i < mRuns.size(); ++i)
+	{
+		if (IsOpen(mRuns[i]))
+			heads.push_back(i);
+	}
+	if (heads.size() < mMaxRuns)
+		return;
+
+	// With the smaller runs merged first, an element goes through a logarithmic number of
+	// merges, like with the levels of SequenceHeap
+	size_t mergeWays = std::max(heads.size() / 2, (size_t)2);
+	std::nth_element(heads.begin(), heads.begin() + (mergeWays - 1), heads.end(),
+		[this](size_t a, size_t b) { return GetRemaining(mRuns[a]) < GetRemaining(mRuns[b]); });
+	heads.resize(mergeWays);
+
+	FILE *file = std::tmpfile();
+	if (!file)
+	{
+		mFailed = true;
+		return;
+	}
+	auto headComp = [this](size_t a, size_t b) { return mComp(GetHead(mRuns[a]), GetHead(mRuns[b])); };
+	std::make_heap(heads.begin(), heads.end(), headComp);
+
+	// Merge them block by block into the new run
+	std::vector<T> block;
+	block.reserve(mBlockElements);
+	size_t count = 0;
+	bool written = true;
+	while (!heads.empty())
+	{
+		std::pop_heap(heads.begin(), heads.end(), headComp);
+		Run& run = mRuns[heads.back()];
+		block.push_back(GetHead(run));
+		Advance(run);
+		if (IsOpen(run))
+			std::push_heap(heads.begin(), heads.end(), headComp);
+		else
+			heads.pop_back();
+
+		if (block.size() == mBlockElements || heads.empty())
+		{
+			written = written && WriteBlock(file, block.data(), block.size());
+			count += block.size();
+			block.clear();
+		}
+	}
+
+	// The source runs are used up by now, so a failed write loses their elements
+	if (!written)
+	{
+		std::fclose(file);
+		mFailed = true;
+		mSize -= count;
+		return;
+	}
+	AddRun(file, count);
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::RunFirst() const
+{
+	if (mHeads.empty())
+		return false;
+	return (mMemory.empty() || mComp(mMemory.front(), GetHead(mRuns[mHeads.front()])));
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class T, class Compare>
+inline size_t ExternalPriorityQueue<T, Compare>::Size() const
+{
+	return mSize;
+}
+
+template<class T, class Compare>
+inline size_t ExternalPriorityQueue<T, Compare>::GetSpilledSize() const
+{
+	return (mSize - mMemory.size());
+}
+
+template<class T, class Compare>
+inline bool ExternalPriorityQueue<T, Compare>::Failed() const
+{
+	return mFailed;
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::Add(const T& e)
+{
+	// Make room on disk, or keep growing in memory if that has failed before
+	if (mMemory.size() >= mHeapElements && !mFailed)
+		Spill();
+
+	// Grow the heap by hand so that its capacity doesn't overshoot the budget
+	if (mMemory.size() == mMemory.capacity() && !mFailed)
+		mMemory.reserve(std::min(std::max(mMemory.capacity() * 2, (size_t)16), mHeapElements));
+
+	mMemory.push_back(e);
+	std::push_heap(mMemory.begin(), mMemory.end(), mComp);
+	++mSize;
+}
+
+template<class T, class Compare>
+inline T ExternalPriorityQueue<T, Compare>::Remove()
+{
+	// Return early if there are no elements
+	if (mSize == 0)
+		return T();
+
+	if (!RunFirst())
+	{
+		std::pop_heap(mMemory.begin(), mMemory.end(), mComp);
+		T ret = mMemory.back();
+		mMemory.pop_back();
+		--mSize;
+		return ret;
+	}
+
+	// Take the head of the best run and move it forward
+	auto headComp = [this](size_t a, size_t b) { return mComp(GetHead(mRuns[a]), GetHead(mRuns[b])); };
+	std::pop_heap(mHeads.begin(), mHeads.end(), headComp);
+	Run& run = mRuns[mHeads.back()];
+	T ret = GetHead(run);
+	--mSize;
+	Advance(run);
+	if (IsOpen(run))
+		std::push_heap(mHeads.begin(), mHeads.end(), headComp);
+	else
+		mHeads.pop_back();
+
+	// Forget the closed runs once they are all gone
+	if (mHeads.empty())
+		mRuns.clear();
+	return ret;
+}
+
+template<class T, class Compare>
+inline const T& ExternalPriorityQueue<T, Compare>::Peek() const
+{
+	return RunFirst() ? GetHead(mRuns[mHeads.front()]) : mMemory.front();
+}
+
+template<class T, class Compare>
+inline void ExternalPriorityQueue<T, Compare>::Clear()
+{
+	for (Run& run : mRuns)
+		CloseRun(run);
+	mRuns.clear();
+	mHeads.clear();
+	mMemory.clear();
+	mSize = 0;
+	mFailed = false;
+}
+
+#endif
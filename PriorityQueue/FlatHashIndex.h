@@ -0,0 +1,203 @@
+//***************************************************************
+// FlatHashIndex.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Open-addressing hash index from element hashes to slots,
+// used by the queues that keep their elements in their own
+// arrays and only need to find the slot of a given element.
+// Entries are stored inline in a single array (32 bits of the
+// mixed hash and the slot, 8 bytes in total), so there is no
+// allocation per element and a lookup is a short linear scan.
+// The elements themselves are never stored here: Find asks the
+// caller to compare a candidate slot with the searched element.
+// Removal shifts the following entries back instead of leaving
+// tombstones, so lookups don't slow down over time.
+// Slots are stored in 32 bits, so they have to be smaller than
+// MAX_SLOTS, which is checked with an assert on insertion.
+//***************************************************************
+
+#ifndef FLAT_HASH_INDEX_H
+#define FLAT_HASH_INDEX_H
+
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+class FlatHashIndex
+{
+public:
+	static const unsigned int NOT_FOUND = ~0u;
+	// Slots from 0 up to this one (excluded) can be indexed
+	static const size_t MAX_SLOTS = NOT_FOUND;
+
+	// Default constructor
+	FlatHashIndex();
+
+	// Number of indexed slots.
+	size_t Size() const;
+
+	// Reserve space for 'count' slots, so that indexing them doesn't grow the table.
+	void Reserve(size_t count);
+
+	// Returns the slot with the given hash for which 'equals(slot)' is true, or NOT_FOUND if there is none.
+	// Executes in O(1) time on average.
+	template<class Equals>
+	unsigned int Find(size_t hash, Equals equals) const;
+
+	// Indexes the slot under the given hash. The same slot must not be indexed twice.
+	// Executes in O(1) time on average.
+	void Insert(size_t hash, size_t slot);
+
+	// Removes the slot that was indexed under the given hash. Does nothing if it is not indexed.
+	// Executes in O(1) time on average.
+	void Erase(size_t hash, size_t slot);
+
+	// Removes every slot but keeps the table allocated.
+	void Clear();
+
+private:
+	struct Entry
+	{
+		// Upper bits of the mixed hash, they also pick the home bucket
+		uint32_t mHashBits;
+		unsigned int mSlot;
+	};
+
+	static const unsigned int EMPTY = NOT_FOUND;
+	static const unsigned int MIN_SHIFT = 3;
+	// The home bucket comes from the 32 bits of the mixed hash
+	static const unsigned int MAX_SHIFT = 32;
+
+	// Spreads the hash over all of the bits, std::hash is often the identity for integers.
+	static uint32_t MixHash(size_t hash);
+	size_t GetHomeBucket(uint32_t hashBits) const;
+	void Rehash(unsigned int shift);
+
+private:
+	std::vector<Entry> mEntries;
+	size_t mMask;
+	unsigned int mShift;
+	size_t mSize;
+};
+
+inline FlatHashIndex::FlatHashIndex()
+	: mMask(0)
+	, mShift(0)
+	, mSize(0)
+{
+
+}
+
+inline uint32_t FlatHashIndex::MixHash(size_t hash)
+{
+	// Fibonacci hashing, the upper bits of the product depend on all of the bits of the hash
+	return (uint32_t)(((uint64_t)hash * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+}
+
+inline size_t FlatHashIndex::GetHomeBucket(uint32_t hashBits) const
+{
+	return (size_t)(hashBits >> (32 - mShift));
+}
+
+inline size_t FlatHashIndex::Size() const
+{
+	return mSize;
+}
+
+inline void FlatHashIndex::Reserve(size_t count)
+{
+	// Keep the load at three quarters at most, probe sequences get long past that
+	unsigned int shift = (mShift > MIN_SHIFT) ? mShift : MIN_SHIFT;
+	while (((size_t)1 << shift) * 3 < count * 4)
+		++shift;
+	if (shift != mShift)
+		Rehash(shift);
+}
+
+template<class Equals>
+inline unsigned int FlatHashIndex::Find(size_t hash, Equals equals) const
+{
+	if (mSize == 0)
+		return NOT_FOUND;
+
+	uint32_t hashBits = MixHash(hash);
+	for (size_t i = GetHomeBucket(hashBits); mEntries[i].mSlot != EMPTY; i = (i + 1) & mMask)
+	{
+		// Only compare the elements when the hashes could match
+		if (mEntries[i].mHashBits == hashBits && equals(mEntries[i].mSlot))
+			return mEntries[i].mSlot;
+	}
+	return NOT_FOUND;
+}
+
+inline void FlatHashIndex::Insert(size_t hash, size_t slot)
+{
+	assert(slot < MAX_SLOTS && "The slot doesn't fit in an entry.");
+	Reserve(mSize + 1);
+
+	uint32_t hashBits = MixHash(hash);
+	size_t i = GetHomeBucket(hashBits);
+	while (mEntries[i].mSlot != EMPTY)
+		i = (i + 1) & mMask;
+	mEntries[i].mHashBits = hashBits;
+	mEntries[i].mSlot = (unsigned int)slot;
+	++mSize;
+}
+
+inline void FlatHashIndex::Erase(size_t hash, size_t slot)
+{
+	if (mSize == 0 || slot >= MAX_SLOTS)
+		return;
+
+	// Find the entry of the slot
+	size_t i = GetHomeBucket(MixHash(hash));
+	while (mEntries[i].mSlot != slot)
+	{
+		if (mEntries[i].mSlot == EMPTY)
+			return;
+		i = (i + 1) & mMask;
+	}
+
+	// Shift back the entries after it that would no longer be reachable from their home buckets
+	for (size_t j = (i + 1) & mMask; mEntries[j].mSlot != EMPTY; j = (j + 1) & mMask)
+	{
+		// The entry at 'j' can fill the hole at 'i' if its home bucket is not cyclically in (i, j]
+		size_t home = GetHomeBucket(mEntries[j].mHashBits);
+		if (((j - home) & mMask) >= ((j - i) & mMask))
+		{
+			mEntries[i] = mEntries[j];
+			i = j;
+		}
+	}
+	mEntries[i].mSlot = EMPTY;
+	--mSize;
+}
+
+inline void FlatHashIndex::Clear()
+{
+	for (Entry& entry : mEntries)
+		entry.mSlot = EMPTY;
+	mSize = 0;
+}
+
+inline void FlatHashIndex::Rehash(unsigned int shift)
+{
+	assert(shift <= MAX_SHIFT && "The table can't grow past 2^32 entries.");
+	std::vector<Entry> oldEntries(((size_t)1 << shift), Entry{ 0, EMPTY });
+	oldEntries.swap(mEntries);
+	mShift = shift;
+	mMask = mEntries.size() - 1;
+
+	// The home buckets come from the stored hash bits, so the elements don't have to be hashed again
+	for (const Entry& entry : oldEntries)
+	{
+		if (entry.mSlot == EMPTY)
+			continue;
+		size_t i = GetHomeBucket(entry.mHashBits);
+		while (mEntries[i].mSlot != EMPTY)
+			i = (i + 1) & mMask;
+		mEntries[i] = entry;
+	}
+}
+
+#endif
@@ -0,0 +1,202 @@
+//***************************************************************
+// HeapChildSelect.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Picks the highest-priority child of a heap node, which is the
+// inner loop of every sift-down. The children of a node in a
+// d-ary heap are next to each other in memory, so for plain
+// float and int priorities ordered with std::less or
+// std::greater, a full set of 4, 8 or 16 children is reduced
+// with vector min/max instructions (SSE, AVX/AVX2 when the
+// compiler targets them) instead of Arity - 1 dependent
+// comparisons. Everything else, including a node with fewer
+// than Arity children, goes through the scalar loop. Both pick
+// the first of equal children, so the heap ends up the same.
+// NaN priorities are not supported (they break std::less too).
+//***************************************************************
+
+#ifndef HEAP_CHILD_SELECT_H
+#define HEAP_CHILD_SELECT_H
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEAP_CHILD_SELECT_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define HEAP_CHILD_SELECT_SSE41
+#include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+#define HEAP_CHILD_SELECT_AVX
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__)
+#define HEAP_CHILD_SELECT_AVX2
+#endif
+
+namespace HeapChildSelect
+{
+	// Whether the comparator puts the largest (1) or the smallest (-1) priority on the top,
+	// or 0 if it is not one of the standard ones and has to be called.
+	template<class T, class Compare>
+	struct Direction : std::integral_constant<int, 0> {};
+	template<class T>
+	struct Direction<T, std::less<T>> : std::integral_constant<int, 1> {};
+	template<class T>
+	struct Direction<T, std::greater<T>> : std::integral_constant<int, -1> {};
+
+	// Vector operations on Width lanes of T. Not available unless specialized below.
+	template<class T, unsigned int Width>
+	struct Lanes
+	{
+		static const bool Available = false;
+	};
+
+	inline unsigned int CountTrailingZeros(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (unsigned int)index;
+#else
+		return (unsigned int)__builtin_ctz(mask);
+#endif
+	}
+
+#if defined(HEAP_CHILD_SELECT_SSE2)
+	template<>
+	struct Lanes<float, 4>
+	{
+		typedef __m128 Vec;
+		static const bool Available = true;
+		static Vec Load(const float *p) { return _mm_loadu_ps(p); }
+		static Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+		static Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+		// Moves the value of the other lanes over, so that the best value ends up in all of them.
+		static Vec Swizzle1(Vec a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)); }
+		static Vec Swizzle2(Vec a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)); }
+		static Vec Swizzle4(Vec a) { return a; }
+		static unsigned int EqualMask(Vec a, Vec b) { return (unsigned int)_mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+	};
+#endif
+
+#if defined(HEAP_CHILD_SELECT_SSE41)
+	template<>
+	struct Lanes<int, 4>
+	{
+		typedef __m128i Vec;
+		static const bool Available = true;
+		static Vec Load(const int *p) { return _mm_loadu_si128((const __m128i*)p); }
+		static Vec Max(Vec a, Vec b) { return _mm_max_epi32(a, b); }
+		static Vec Min(Vec a, Vec b) { return _mm_min_epi32(a, b); }
+		static Vec Swizzle1(Vec a) { return _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+		static Vec Swizzle2(Vec a) { return _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)); }
+		static Vec Swizzle4(Vec a) { return a; }
+		static unsigned int EqualMask(Vec a, Vec b) { return (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+	};
+#endif
+
+#if defined(HEAP_CHILD_SELECT_AVX)
+	template<>
+	struct Lanes<float, 8>
+	{
+		typedef __m256 Vec;
+		static const bool Available = true;
+		static Vec Load(const float *p) { return _mm256_loadu_ps(p); }
+		static Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+		static Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+		static Vec Swizzle1(Vec a) { return _mm256_permute_ps(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+		static Vec Swizzle2(Vec a) { return _mm256_permute_ps(a, _MM_SHUFFLE(1, 0, 3, 2)); }
+		static Vec Swizzle4(Vec a) { return _mm256_permute2f128_ps(a, a, 1); }
+		static unsigned int EqualMask(Vec a, Vec b) { return (unsigned int)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+	};
+#endif
+
+#if defined(HEAP_CHILD_SELECT_AVX2)
+	template<>
+	struct Lanes<int, 8>
+	{
+		typedef __m256i Vec;
+		static const bool Available = true;
+		static Vec Load(const int *p) { return _mm256_loadu_si256((const __m256i*)p); }
+		static Vec Max(Vec a, Vec b) { return _mm256_max_epi32(a, b); }
+		static Vec Min(Vec a, Vec b) { return _mm256_min_epi32(a, b); }
+		static Vec Swizzle1(Vec a) { return _mm256_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1)); }
+		static Vec Swizzle2(Vec a) { return _mm256_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)); }
+		static Vec Swizzle4(Vec a) { return _mm256_permute2x128_si256(a, a, 1); }
+		static unsigned int EqualMask(Vec a, Vec b) { return (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+	};
+#endif
+
+	// The widest lanes that evenly cover the children of a node.
+	template<class T, unsigned int Arity>
+	struct ChildLanes : std::conditional<(Lanes<T, 8>::Available && Arity % 8 == 0), Lanes<T, 8>, Lanes<T, 4>>::type
+	{
+		static const unsigned int Width = (Lanes<T, 8>::Available && Arity % 8 == 0) ? 8 : 4;
+		static const bool Usable = (ChildLanes::Available && Arity % Width == 0);
+	};
+
+	template<class T, class Compare, unsigned int Arity, bool Simd = (Direction<T, Compare>::value != 0 && ChildLanes<T, Arity>::Usable)>
+	struct Selector
+	{
+		static size_t Select(const T *children, size_t count, const Compare& comp)
+		{
+			size_t best = 0;
+			for (size_t i = 1; i < count; ++i)
+			{
+				if (comp(children[best], children[i]))
+					best = i;
+			}
+			return best;
+		}
+	};
+
+	template<class T, class Compare, unsigned int Arity>
+	struct Selector<T, Compare, Arity, true>
+	{
+		typedef ChildLanes<T, Arity> L;
+		typedef typename L::Vec Vec;
+
+		static Vec Best(Vec a, Vec b) { return (Direction<T, Compare>::value > 0) ? L::Max(a, b) : L::Min(a, b); }
+
+		static size_t Select(const T *children, size_t count, const Compare& comp)
+		{
+			// The last node may have fewer children than there are lanes
+			if (count != Arity)
+				return Selector<T, Compare, Arity, false>::Select(children, count, comp);
+
+			// Reduce all of the children to one vector, then spread its best lane over all of them
+			Vec best = L::Load(children);
+			for (unsigned int i = L::Width; i < Arity; i += L::Width)
+				best = Best(best, L::Load(children + i));
+			best = Best(best, L::Swizzle1(best));
+			best = Best(best, L::Swizzle2(best));
+			best = Best(best, L::Swizzle4(best));
+
+			// The first child equal to it is the one the scalar loop would have picked
+			for (unsigned int i = 0; i < Arity; i += L::Width)
+			{
+				unsigned int mask = L::EqualMask(L::Load(children + i), best);
+				if (mask != 0)
+					return i + CountTrailingZeros(mask);
+			}
+			return 0;
+		}
+	};
+}
+
+// Returns the offset of the highest-priority one among the 'count' children starting at 'children',
+// where 'count' is at most Arity. The first one wins among children of equal priority.
+template<unsigned int Arity, class T, class Compare>
+inline size_t SelectHeapChild(const T *children, size_t count, const Compare& comp)
+{
+	return HeapChildSelect::Selector<T, Compare, Arity>::Select(children, count, comp);
+}
+
+#endif
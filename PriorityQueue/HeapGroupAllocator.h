@@ -0,0 +1,73 @@
+//***************************************************************
+// HeapGroupAllocator.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Allocator for the array of a d-ary heap. The children of
+// node i start at i * Arity + 1, so the array is placed with
+// its second element on a cache line boundary. Every group of
+// siblings then starts at a multiple of Arity elements from
+// it, and when Arity * sizeof(T) divides the cache line size
+// (e.g. 16 floats, 8 doubles or 4 16-byte elements) no group
+// ever straddles two cache lines.
+//***************************************************************
+
+#ifndef HEAP_GROUP_ALLOCATOR_H
+#define HEAP_GROUP_ALLOCATOR_H
+
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+template<class T>
+class HeapGroupAllocator
+{
+public:
+	typedef T value_type;
+
+	static const size_t CACHE_LINE_SIZE = 64;
+
+	HeapGroupAllocator() {}
+	template<class U>
+	HeapGroupAllocator(const HeapGroupAllocator<U>&) {}
+
+	T *allocate(size_t n);
+	void deallocate(T *p, size_t n);
+
+	template<class U>
+	bool operator==(const HeapGroupAllocator<U>&) const { return true; }
+	template<class U>
+	bool operator!=(const HeapGroupAllocator<U>&) const { return false; }
+};
+
+template<class T>
+const size_t HeapGroupAllocator<T>::CACHE_LINE_SIZE;
+
+template<class T>
+inline T *HeapGroupAllocator<T>::allocate(size_t n)
+{
+	static_assert(CACHE_LINE_SIZE % alignof(T) == 0, "The elements can't be aligned more strictly than the cache lines.");
+
+	// Room for shifting the array and for the pointer to the original block in front of it
+	size_t extra = CACHE_LINE_SIZE + sizeof(void*);
+	if (n > (~size_t(0) - extra) / sizeof(T))
+		throw std::bad_alloc();
+	void *raw = ::operator new(n * sizeof(T) + extra);
+
+	// The second element goes to the cache line boundary, so the first one starts
+	// sizeof(T) before it. Both sizes are multiples of alignof(T), so this is aligned for T.
+	uintptr_t start = (uintptr_t)raw + sizeof(void*);
+	uintptr_t shift = (CACHE_LINE_SIZE - (start + sizeof(T)) % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
+	unsigned char *p = (unsigned char*)start + shift;
+	std::memcpy(p - sizeof(void*), &raw, sizeof(void*));
+	return (T*)p;
+}
+
+template<class T>
+inline void HeapGroupAllocator<T>::deallocate(T *p, size_t)
+{
+	void *raw;
+	std::memcpy(&raw, (unsigned char*)p - sizeof(void*), sizeof(void*));
+	::operator delete(raw);
+}
+
+#endif
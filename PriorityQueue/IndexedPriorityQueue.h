@@ -0,0 +1,279 @@
+//***************************************************************
+// IndexedPriorityQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Priority queue for elements identified by dense integer ids
+// in the range [0, N), such as vertex or entity indices.
+// Unlike PriorityQueue, the position of every id is tracked in
+// a flat array instead of a hash map, so checking whether an id
+// is in the queue and changing its priority don't hash at all.
+// Priorities are kept in their own array in heap order, next to
+// the ids, so sifting only touches compact arrays. With float
+// or int priorities and an Arity of 4, 8 or 16, the best child
+// is picked with vector instructions (see HeapChildSelect.h).
+// Ordering follows PriorityQueue: with std::less the element
+// with the greatest priority is on the top, use std::greater
+// to get the smallest one (e.g. for Dijkstra).
+//***************************************************************
+
+#ifndef INDEXED_PRIORITY_QUEUE_H
+#define INDEXED_PRIORITY_QUEUE_H
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "HeapChildSelect.h"
+
+template <class Priority, class Compare = std::less<Priority>, unsigned int Arity = 2>
+class IndexedPriorityQueue
+{
+	static_assert(Arity >= 2, "The heap needs at least two children per node.");
+
+public:
+	// Default constructor
+	IndexedPriorityQueue();
+
+	// Constructor that reserves space for ids in the range [0, idCount).
+	IndexedPriorityQueue(unsigned int idCount, const Compare& comp = Compare());
+
+	// Reserves space for ids in the range [0, idCount). Larger ids are still
+	// accepted, the position array simply grows when they are added.
+	void Reserve(unsigned int idCount);
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the queue.
+	size_t Size() const;
+
+	// Check whether the id is in the queue.
+	// Executes in O(1) time.
+	bool Contains(unsigned int id) const;
+
+	// Add an id to the queue with an associated priority. Does nothing if the id is already present.
+	// Executes in O(log n) time.
+	void Add(unsigned int id, const Priority& priority);
+
+	// Remove the id from the queue that has the highest priority, and return it.
+	// Executes in O(log n) time.
+	unsigned int Remove();
+
+	// Peek, which returns the highest - priority id but does not modify the queue.
+	// Executes in O(1) time.
+	unsigned int Peek() const;
+
+	// Returns the priority of the highest - priority id.
+	// Executes in O(1) time.
+	const Priority& PeekPriority() const;
+
+	// Returns the priority of an id that is in the queue.
+	// Executes in O(1) time.
+	const Priority& GetPriority(unsigned int id) const;
+
+	// Changes the priority of an id that is in the queue, in either direction.
+	// Returns false if the id is not in the queue.
+	// Executes in O(log n) time.
+	bool Update(unsigned int id, const Priority& priority);
+
+	// Clears everything in the queue. Only touches the ids that are in the queue.
+	void Clear();
+
+private:
+	static const unsigned int NOT_IN_QUEUE = ~0u;
+
+	size_t GetParentPosition(size_t child) const;
+	size_t GetFirstChildPosition(size_t parent) const;
+	// Moves the element up or down from 'ePos' until the heap property is restored.
+	// The priority is taken by value since it may refer to a slot that gets overwritten.
+	void BubbleUp(size_t ePos, unsigned int id, Priority priority);
+	void BubbleDown(size_t ePos, unsigned int id, Priority priority);
+	void Place(size_t ePos, unsigned int id, const Priority& priority);
+
+private:
+	std::vector<unsigned int> mIds;
+	std::vector<Priority> mPriorities;
+	std::vector<unsigned int> mIdToPos;
+	Compare mComp;
+};
+
+template<class Priority, class Compare, unsigned int Arity>
+const unsigned int IndexedPriorityQueue<Priority, Compare, Arity>::NOT_IN_QUEUE;
+
+template<class Priority, class Compare, unsigned int Arity>
+inline IndexedPriorityQueue<Priority, Compare, Arity>::IndexedPriorityQueue()
+	: IndexedPriorityQueue<Priority, Compare, Arity>(0)
+{
+
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline IndexedPriorityQueue<Priority, Compare, Arity>::IndexedPriorityQueue(unsigned int idCount, const Compare& comp)
+	: mComp(comp)
+{
+	Reserve(idCount);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::Reserve(unsigned int idCount)
+{
+	if (idCount > mIdToPos.size())
+		mIdToPos.resize(idCount, NOT_IN_QUEUE);
+	mIds.reserve(idCount);
+	mPriorities.reserve(idCount);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline size_t IndexedPriorityQueue<Priority, Compare, Arity>::GetParentPosition(size_t child) const
+{
+	return ((child - 1) / Arity);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline size_t IndexedPriorityQueue<Priority, Compare, Arity>::GetFirstChildPosition(size_t parent) const
+{
+	return (parent * Arity + 1);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::Place(size_t ePos, unsigned int id, const Priority& priority)
+{
+	mIds[ePos] = id;
+	mPriorities[ePos] = priority;
+	mIdToPos[id] = (unsigned int)ePos;
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::BubbleUp(size_t ePos, unsigned int id, Priority priority)
+{
+	// Instead of swapping, move the parents down into the hole until the right spot is found.
+	while (ePos != 0)
+	{
+		size_t pPos = GetParentPosition(ePos);
+		if (!mComp(mPriorities[pPos], priority))
+			break;
+		Place(ePos, mIds[pPos], mPriorities[pPos]);
+		ePos = pPos;
+	}
+	Place(ePos, id, priority);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::BubbleDown(size_t ePos, unsigned int id, Priority priority)
+{
+	// Instead of swapping, move the children up into the hole until the right spot is found.
+	size_t size = mIds.size();
+	while (true)
+	{
+		size_t fcPos = GetFirstChildPosition(ePos);
+		if (fcPos >= size)
+			break;
+
+		// Prioritize between the children that are within the bounds.
+		size_t lastPos = std::min(fcPos + Arity, size);
+		size_t higherPriorityChildPos = fcPos + SelectHeapChild<Arity>(&mPriorities[fcPos], lastPos - fcPos, mComp);
+
+		if (!mComp(priority, mPriorities[higherPriorityChildPos]))
+			break;
+		Place(ePos, mIds[higherPriorityChildPos], mPriorities[higherPriorityChildPos]);
+		ePos = higherPriorityChildPos;
+	}
+	Place(ePos, id, priority);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline bool IndexedPriorityQueue<Priority, Compare, Arity>::Empty() const
+{
+	return mIds.empty();
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline size_t IndexedPriorityQueue<Priority, Compare, Arity>::Size() const
+{
+	return mIds.size();
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline bool IndexedPriorityQueue<Priority, Compare, Arity>::Contains(unsigned int id) const
+{
+	return (id < mIdToPos.size() && mIdToPos[id] != NOT_IN_QUEUE);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::Add(unsigned int id, const Priority& priority)
+{
+	// Return early if the id is already present
+	if (Contains(id))
+		return;
+
+	if (id >= mIdToPos.size())
+		mIdToPos.resize(id + 1, NOT_IN_QUEUE);
+
+	// Make room at the back and bubble the new element up from there
+	mIds.push_back(id);
+	mPriorities.push_back(priority);
+	BubbleUp(mIds.size() - 1, id, priority);
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline unsigned int IndexedPriorityQueue<Priority, Compare, Arity>::Remove()
+{
+	assert(!Empty() && "Remove on an empty queue.");
+	unsigned int ret = mIds.front();
+	mIdToPos[ret] = NOT_IN_QUEUE;
+
+	// Take the last element out and sink it down from the top
+	unsigned int lastId = mIds.back();
+	Priority lastPriority = mPriorities.back();
+	mIds.pop_back();
+	mPriorities.pop_back();
+	if (!mIds.empty())
+		BubbleDown(0, lastId, lastPriority);
+
+	return ret;
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline unsigned int IndexedPriorityQueue<Priority, Compare, Arity>::Peek() const
+{
+	assert(!Empty() && "Peek on an empty queue.");
+	return mIds.front();
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline const Priority& IndexedPriorityQueue<Priority, Compare, Arity>::PeekPriority() const
+{
+	assert(!Empty() && "Peek on an empty queue.");
+	return mPriorities.front();
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline const Priority& IndexedPriorityQueue<Priority, Compare, Arity>::GetPriority(unsigned int id) const
+{
+	return mPriorities[mIdToPos[id]];
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline bool IndexedPriorityQueue<Priority, Compare, Arity>::Update(unsigned int id, const Priority& priority)
+{
+	if (!Contains(id))
+		return false;
+
+	size_t ePos = mIdToPos[id];
+	if (mComp(mPriorities[ePos], priority))
+		BubbleUp(ePos, id, priority);
+	else
+		BubbleDown(ePos, id, priority);
+	return true;
+}
+
+template<class Priority, class Compare, unsigned int Arity>
+inline void IndexedPriorityQueue<Priority, Compare, Arity>::Clear()
+{
+	for (unsigned int id : mIds)
+		mIdToPos[id] = NOT_IN_QUEUE;
+	mIds.clear();
+	mPriorities.clear();
+}
+
+#endif
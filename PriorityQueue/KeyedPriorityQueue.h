@@ -0,0 +1,290 @@
+//***************************************************************
+// KeyedPriorityQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Priority queue where the identity of an element (the key)
+// is separate from its priority. Unlike PriorityQueue, where
+// the value is both, changing a priority never touches the
+// hash index: every key gets a slot, and the slots are kept in
+// an IndexedPriorityQueue with the priorities in a compact
+// array next to them. Updating a priority through a handle is
+// a pure array operation, updating it by key costs a single
+// lookup. Ordering follows PriorityQueue: with std::less the
+// key with the greatest priority is on the top.
+//***************************************************************
+
+#ifndef KEYED_PRIORITY_QUEUE_H
+#define KEYED_PRIORITY_QUEUE_H
+
+#include <vector>
+#include <cassert>
+#include <utility>
+#include <functional>
+#include "IndexedPriorityQueue.h"
+#include "SlotTable.h"
+
+template <class Key, class Priority, class Compare = std::less<Priority>, unsigned int Arity = 2>
+class KeyedPriorityQueue
+{
+public:
+	// Refers to one key in the queue. Stays valid until that key is removed from the queue,
+	// regardless of what happens to the other keys.
+	// Handles are cheap to copy and any number of them may exist at once.
+	class ElementHandle
+	{
+		friend class KeyedPriorityQueue<Key, Priority, Compare, Arity>;
+
+	public:
+		// Creates a handle that doesn't refer to any key.
+		ElementHandle() : mOwnerPt(nullptr), mSlot(0), mGeneration(0) {}
+
+		// Check whether the key this handle refers to is still in the queue.
+		bool IsValid() const { return (mOwnerPt && mOwnerPt->mSlots.GetGeneration(mSlot) == mGeneration); }
+
+		// Returns the key this handle refers to. The handle must be valid.
+		const Key& GetKey() const { return mOwnerPt->mKeys[mSlot]; }
+
+		// Returns the priority of the key this handle refers to. The handle must be valid.
+		const Priority& GetPriority() const { return mOwnerPt->mQueue.GetPriority(mSlot); }
+
+		// Changes the priority of the key and then updates the containing queue.
+		// Returns true if successful.
+		// Executes in O(log n) time.
+		bool Update(const Priority& priority) { return (IsValid() && mOwnerPt->mQueue.Update(mSlot, priority)); }
+
+	private:
+		ElementHandle(KeyedPriorityQueue<Key, Priority, Compare, Arity> *ownerPt, unsigned int slot)
+			: mOwnerPt(ownerPt), mSlot(slot), mGeneration(ownerPt->mSlots.GetGeneration(slot)) {}
+		KeyedPriorityQueue<Key, Priority, Compare, Arity> *mOwnerPt;
+		unsigned int mSlot;
+		unsigned int mGeneration;
+	};
+
+public:
+	// Default constructor
+	KeyedPriorityQueue();
+
+	// Constructor with a comparison function object
+	KeyedPriorityQueue(const Compare& comp);
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of keys in the queue.
+	size_t Size() const;
+
+	// Reserve space for 'count' keys.
+	void Reserve(size_t count);
+
+	// Check whether the key is in the queue.
+	// Executes in O(1) time on average.
+	bool Contains(const Key& key) const;
+
+	// Add a key to the queue with an associated priority and return the handle to it.
+	// If the key is already present, the handle to it is returned and its priority is kept.
+	// Executes in O(log n) time on average.
+	ElementHandle Add(const Key& key, const Priority& priority);
+	ElementHandle Add(Key&& key, const Priority& priority);
+
+	// Remove the key with the highest priority, and move it out.
+	// Returns Key() if the queue is empty.
+	// Executes in O(log n) time.
+	Key Remove();
+
+	// Peek, which returns the highest - priority key but does not modify the queue.
+	// The queue must not be empty.
+	// Executes in O(1) time.
+	const Key& Peek() const;
+
+	// Returns the priority of the highest - priority key. The queue must not be empty.
+	// Executes in O(1) time.
+	const Priority& PeekPriority() const;
+
+	// Returns the priority of a key that is in the queue.
+	// Executes in O(1) time on average.
+	const Priority& GetPriority(const Key& key) const;
+
+	// Changes the priority of a key that is in the queue, in either direction.
+	// Returns false if the key is not in the queue.
+	// Executes in O(log n) time on average.
+	bool Update(const Key& key, const Priority& priority);
+
+	// Get a handle that will allow to update the priority of a key without looking it up again.
+	// The handle is not valid if the key is not in the queue.
+	ElementHandle GetElementHandle(const Key& key);
+
+	// Clears everything in the queue
+	void Clear();
+
+private:
+	static const unsigned int NO_SLOT = SlotTable<unsigned int>::NO_SLOT;
+
+	template<class U>
+	ElementHandle AddKey(U&& key, const Priority& priority);
+	// Returns the slot of the key or NO_SLOT if it is not in the queue.
+	unsigned int FindSlot(const Key& key, size_t hash) const;
+
+private:
+	// Slots ordered by the priority, the priorities are kept in there as well
+	IndexedPriorityQueue<Priority, Compare, Arity> mQueue;
+	// Key occupying each slot
+	std::vector<Key> mKeys;
+	// Generations and hashes of the slots, the keys themselves are compared in mKeys
+	SlotTable<unsigned int> mSlots;
+	std::hash<Key> mHash;
+};
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+const unsigned int KeyedPriorityQueue<Key, Priority, Compare, Arity>::NO_SLOT;
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline KeyedPriorityQueue<Key, Priority, Compare, Arity>::KeyedPriorityQueue()
+	: KeyedPriorityQueue<Key, Priority, Compare, Arity>(Compare())
+{
+
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline KeyedPriorityQueue<Key, Priority, Compare, Arity>::KeyedPriorityQueue(const Compare& comp)
+	: mQueue(0, comp)
+{
+
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline unsigned int KeyedPriorityQueue<Key, Priority, Compare, Arity>::FindSlot(const Key& key, size_t hash) const
+{
+	return mSlots.Find(hash, [&](unsigned int s) { return (mKeys[s] == key); });
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline bool KeyedPriorityQueue<Key, Priority, Compare, Arity>::Empty() const
+{
+	return mQueue.Empty();
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline size_t KeyedPriorityQueue<Key, Priority, Compare, Arity>::Size() const
+{
+	return mQueue.Size();
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline void KeyedPriorityQueue<Key, Priority, Compare, Arity>::Reserve(size_t count)
+{
+	mQueue.Reserve((unsigned int)count);
+	mKeys.reserve(count);
+	mSlots.Reserve(count);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline bool KeyedPriorityQueue<Key, Priority, Compare, Arity>::Contains(const Key& key) const
+{
+	return (FindSlot(key, mHash(key)) != NO_SLOT);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+template<class U>
+inline typename KeyedPriorityQueue<Key, Priority, Compare, Arity>::ElementHandle
+	KeyedPriorityQueue<Key, Priority, Compare, Arity>::AddKey(U&& key, const Priority& priority)
+{
+	// Return early if the key is already present
+	size_t hash = mHash(key);
+	unsigned int slot = FindSlot(key, hash);
+	if (slot != NO_SLOT)
+		return ElementHandle(this, slot);
+
+	// Give it a slot and index it
+	slot = mSlots.Allocate();
+	if (slot < mKeys.size())
+		mKeys[slot] = std::forward<U>(key);
+	else
+		mKeys.push_back(std::forward<U>(key));
+	mSlots.Index(slot, hash);
+
+	// Then queue the slot
+	mQueue.Add(slot, priority);
+	return ElementHandle(this, slot);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline typename KeyedPriorityQueue<Key, Priority, Compare, Arity>::ElementHandle
+	KeyedPriorityQueue<Key, Priority, Compare, Arity>::Add(const Key& key, const Priority& priority)
+{
+	return AddKey(key, priority);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline typename KeyedPriorityQueue<Key, Priority, Compare, Arity>::ElementHandle
+	KeyedPriorityQueue<Key, Priority, Compare, Arity>::Add(Key&& key, const Priority& priority)
+{
+	return AddKey(std::move(key), priority);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline Key KeyedPriorityQueue<Key, Priority, Compare, Arity>::Remove()
+{
+	// Return early if there are no keys
+	if (mQueue.Empty())
+		return Key();
+
+	unsigned int slot = mQueue.Remove();
+	mSlots.Free(slot);
+	return std::move(mKeys[slot]);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline const Key& KeyedPriorityQueue<Key, Priority, Compare, Arity>::Peek() const
+{
+	assert(!mQueue.Empty() && "Peek on an empty queue.");
+	return mKeys[mQueue.Peek()];
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline const Priority& KeyedPriorityQueue<Key, Priority, Compare, Arity>::PeekPriority() const
+{
+	assert(!mQueue.Empty() && "Peek on an empty queue.");
+	return mQueue.PeekPriority();
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline const Priority& KeyedPriorityQueue<Key, Priority, Compare, Arity>::GetPriority(const Key& key) const
+{
+	unsigned int slot = FindSlot(key, mHash(key));
+	assert(slot != NO_SLOT && "The key is not in the queue.");
+	return mQueue.GetPriority(slot);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline bool KeyedPriorityQueue<Key, Priority, Compare, Arity>::Update(const Key& key, const Priority& priority)
+{
+	unsigned int slot = FindSlot(key, mHash(key));
+	if (slot == NO_SLOT)
+		return false;
+
+	return mQueue.Update(slot, priority);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline typename KeyedPriorityQueue<Key, Priority, Compare, Arity>::ElementHandle
+	KeyedPriorityQueue<Key, Priority, Compare, Arity>::GetElementHandle(const Key& key)
+{
+	unsigned int slot = FindSlot(key, mHash(key));
+	if (slot == NO_SLOT)
+		return ElementHandle();
+	return ElementHandle(this, slot);
+}
+
+template<class Key, class Priority, class Compare, unsigned int Arity>
+inline void KeyedPriorityQueue<Key, Priority, Compare, Arity>::Clear()
+{
+	// Free the slots so that the outstanding handles become invalid
+	for (unsigned int slot = 0; slot < mSlots.GetSlotCount(); ++slot)
+	{
+		if (mQueue.Contains(slot))
+			mSlots.Free(slot);
+	}
+	mQueue.Clear();
+}
+
+#endif
@@ -0,0 +1,490 @@
+//***************************************************************
+// LazyPriorityQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Variant of PriorityQueue with lazy deletion. Erasing or
+// updating an element doesn't reposition it in the heap: its
+// entry is only marked as dead (a tombstone) and an updated
+// element gets a new entry. Removing skips the tombstones when
+// they reach the top. Since no entry ever has to be found in
+// the heap, the heap doesn't track positions at all and sifting
+// only moves entries around in three compact arrays.
+// Once the tombstones make up more than a set fraction of the
+// heap, they are all dropped and the heap is rebuilt in O(n).
+// Every entry keeps its own copy of the value it was queued
+// with, so T has to be copyable. Ordering, duplicates and
+// handles behave the same as in PriorityQueue.
+//***************************************************************
+
+#ifndef LAZY_PRIORITY_QUEUE_H
+#define LAZY_PRIORITY_QUEUE_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "SlotTable.h"
+#include "HeapChildSelect.h"
+
+template <class T, class Compare = std::less<T>, unsigned int Arity = 2>
+class LazyPriorityQueue
+{
+	static_assert(Arity >= 2, "The heap needs at least two children per node.");
+
+	friend class ElementHandle;
+
+public:
+	// Refers to one element of the queue. Stays valid until that element is removed
+	// from the queue, regardless of what happens to the other elements.
+	// Handles are cheap to copy and any number of them may exist at once.
+	class ElementHandle
+	{
+		friend class LazyPriorityQueue<T, Compare, Arity>;
+
+	public:
+		// Creates a handle that doesn't refer to any element.
+		ElementHandle() : mOwnerPt(nullptr), mSlot(0), mGeneration(0) {}
+
+		// Check whether the element this handle refers to is still in the queue.
+		bool IsValid() const { return (mOwnerPt && mOwnerPt->mSlots.GetGeneration(mSlot) == mGeneration); }
+
+		// Returns the element this handle refers to. The handle must be valid.
+		const T& Get() const { return mOwnerPt->mSlotValues[mSlot]; }
+
+		// Updates the element to a new value and then updates the
+		// containing queue. Returns true if successful.
+		// Executes in O(log n) time on average.
+		bool Update(const T& newVal) { return (mOwnerPt && mOwnerPt->SetValue(*this, newVal)); }
+
+	private:
+		ElementHandle(LazyPriorityQueue<T, Compare, Arity> *ownerPt, unsigned int slot)
+			: mOwnerPt(ownerPt), mSlot(slot), mGeneration(ownerPt->mSlots.GetGeneration(slot)) {}
+		LazyPriorityQueue<T, Compare, Arity> *mOwnerPt;
+		unsigned int mSlot;
+		unsigned int mGeneration;
+	};
+
+public:
+	// Default constructor
+	LazyPriorityQueue();
+
+	// Constructor with a comparison function object
+	LazyPriorityQueue(const Compare& comp);
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the queue, not counting the tombstones.
+	size_t Size() const;
+
+	// Reserve space for 'count' elements.
+	void Reserve(size_t count);
+
+	// Sets the fraction of the heap entries that may be tombstones before they are all dropped
+	// and the heap is rebuilt. Lower values keep the heap smaller, higher ones rebuild it less often.
+	// The default is 0.5.
+	void SetCompactionThreshold(float deadFraction);
+
+	// Add an element to the queue and return the handle to it.
+	// If the element is already present, the handle to the existing one is returned.
+	// Executes in O(log n) time on average.
+	ElementHandle Add(const T& e);
+
+	// Remove the element from the queue that has the highest priority, and return it.
+	// Executes in O(log n) amortized time.
+	T Remove();
+
+	// Remove the element with the given value from the queue. Returns false if it is not present.
+	// Executes in O(1) amortized time on average.
+	bool Erase(const T& e);
+
+	// Remove the element the handle refers to from the queue. Returns false if the handle is not valid.
+	// Executes in O(1) amortized time.
+	bool Erase(const ElementHandle& handle);
+
+	// Peek, which returns the highest - priority element but does not modify the queue.
+	// Executes in O(1) time.
+	const T& Peek() const;
+
+	// Clears everything in the queue
+	void Clear();
+
+	// Get a handle that will allow to update elements in the heap.
+	// The handle is not valid if the element is not in the queue.
+	ElementHandle GetElementHandle(const T& e);
+
+private:
+	static const unsigned int NO_SLOT = SlotTable<unsigned int>::NO_SLOT;
+
+	size_t GetParentPosition(size_t child) const;
+	size_t GetFirstChildPosition(size_t parent) const;
+	bool IsLive(size_t ePos) const;
+	// Appends a live entry for the slot and sifts it up.
+	void Push(const T& e, unsigned int slot);
+	// Takes the entry at the top out of the heap.
+	void Pop();
+	// Pops the tombstones off the top, so that the top is always a live entry.
+	void PruneTop();
+	// Marks the entry of the slot as dead. Its element is not touched.
+	void Kill(unsigned int slot);
+	// Drops all of the tombstones and rebuilds the heap if there are too many of them.
+	void CompactIfNeeded();
+	template<class U>
+	bool SetValue(const ElementHandle& handle, U&& newVal);
+	// Returns the slot of the element equal to 'e' or NO_SLOT if there is none.
+	unsigned int FindSlot(const T& e, size_t hash) const;
+	unsigned int AllocateSlot();
+	// Moves the entry up or down from 'ePos' until the heap property is restored.
+	// The value is taken by value since it may refer to an entry that gets overwritten.
+	void BubbleUp(size_t ePos, T value, unsigned int slot, unsigned int stamp);
+	void BubbleDown(size_t ePos, T value, unsigned int slot, unsigned int stamp);
+	void Place(size_t ePos, T&& value, unsigned int slot, unsigned int stamp);
+	void MakeHeap();
+
+private:
+	// Heap entries in the heap order: the value, the slot and the stamp it was queued with
+	std::vector<T> mHeapValues;
+	std::vector<unsigned int> mHeapSlots;
+	std::vector<unsigned int> mHeapStamps;
+	// Current element of each slot
+	std::vector<T> mSlotValues;
+	// Bumped every time the element of a slot is updated or removed, so that its old entries become tombstones
+	std::vector<unsigned int> mSlotStamps;
+	// Generations and hashes of the slots, the elements themselves are compared in mSlotValues
+	SlotTable<unsigned int> mSlots;
+	std::hash<T> mHash;
+	Compare mComp;
+	size_t mDeadCount;
+	float mCompactionThreshold;
+};
+
+template<class T, class Compare, unsigned int Arity>
+const unsigned int LazyPriorityQueue<T, Compare, Arity>::NO_SLOT;
+
+template<class T, class Compare, unsigned int Arity>
+inline LazyPriorityQueue<T, Compare, Arity>::LazyPriorityQueue()
+	: LazyPriorityQueue<T, Compare, Arity>(Compare())
+{
+
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline LazyPriorityQueue<T, Compare, Arity>::LazyPriorityQueue(const Compare& comp)
+	: mComp(comp)
+	, mDeadCount(0)
+	, mCompactionThreshold(0.5f)
+{
+
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t LazyPriorityQueue<T, Compare, Arity>::GetParentPosition(size_t child) const
+{
+	return ((child - 1) / Arity);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t LazyPriorityQueue<T, Compare, Arity>::GetFirstChildPosition(size_t parent) const
+{
+	return (parent * Arity + 1);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline bool LazyPriorityQueue<T, Compare, Arity>::IsLive(size_t ePos) const
+{
+	return (mHeapStamps[ePos] == mSlotStamps[mHeapSlots[ePos]]);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Place(size_t ePos, T&& value, unsigned int slot, unsigned int stamp)
+{
+	mHeapValues[ePos] = std::move(value);
+	mHeapSlots[ePos] = slot;
+	mHeapStamps[ePos] = stamp;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::BubbleUp(size_t ePos, T value, unsigned int slot, unsigned int stamp)
+{
+	// Instead of swapping, move the parents down into the hole until the right spot is found.
+	while (ePos != 0)
+	{
+		size_t pPos = GetParentPosition(ePos);
+		if (!mComp(mHeapValues[pPos], value))
+			break;
+		Place(ePos, std::move(mHeapValues[pPos]), mHeapSlots[pPos], mHeapStamps[pPos]);
+		ePos = pPos;
+	}
+	Place(ePos, std::move(value), slot, stamp);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::BubbleDown(size_t ePos, T value, unsigned int slot, unsigned int stamp)
+{
+	// Instead of swapping, move the children up into the hole until the right spot is found.
+	size_t size = mHeapValues.size();
+	while (true)
+	{
+		size_t fcPos = GetFirstChildPosition(ePos);
+		if (fcPos >= size)
+			break;
+
+		// Prioritize between the children that are within the bounds.
+		size_t lastPos = std::min(fcPos + Arity, size);
+		size_t higherPriorityChildPos = fcPos + SelectHeapChild<Arity>(&mHeapValues[fcPos], lastPos - fcPos, mComp);
+
+		if (!mComp(value, mHeapValues[higherPriorityChildPos]))
+			break;
+		Place(ePos, std::move(mHeapValues[higherPriorityChildPos]), mHeapSlots[higherPriorityChildPos], mHeapStamps[higherPriorityChildPos]);
+		ePos = higherPriorityChildPos;
+	}
+	Place(ePos, std::move(value), slot, stamp);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::MakeHeap()
+{
+	// Floyd's method: sink every inner node, starting from the last one.
+	if (mHeapValues.size() < 2)
+		return;
+	for (size_t ePos = GetParentPosition(mHeapValues.size() - 1) + 1; ePos-- > 0;)
+		BubbleDown(ePos, std::move(mHeapValues[ePos]), mHeapSlots[ePos], mHeapStamps[ePos]);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Push(const T& e, unsigned int slot)
+{
+	// Make room at the back and bubble the new entry up from there
+	mHeapValues.push_back(e);
+	mHeapSlots.push_back(slot);
+	mHeapStamps.push_back(mSlotStamps[slot]);
+	BubbleUp(mHeapValues.size() - 1, e, slot, mSlotStamps[slot]);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Pop()
+{
+	// Take the last entry out and sink it down from the top
+	T lastValue = std::move(mHeapValues.back());
+	unsigned int lastSlot = mHeapSlots.back();
+	unsigned int lastStamp = mHeapStamps.back();
+	mHeapValues.pop_back();
+	mHeapSlots.pop_back();
+	mHeapStamps.pop_back();
+	if (!mHeapValues.empty())
+		BubbleDown(0, std::move(lastValue), lastSlot, lastStamp);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::PruneTop()
+{
+	while (!mHeapValues.empty() && !IsLive(0))
+	{
+		Pop();
+		--mDeadCount;
+	}
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Kill(unsigned int slot)
+{
+	++mSlotStamps[slot];
+	++mDeadCount;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::CompactIfNeeded()
+{
+	PruneTop();
+	if (mDeadCount <= mHeapValues.size() * mCompactionThreshold)
+		return;
+
+	// Keep the live entries at the front, in any order
+	size_t liveCount = 0;
+	for (size_t ePos = 0; ePos < mHeapValues.size(); ++ePos)
+	{
+		if (!IsLive(ePos))
+			continue;
+		if (ePos != liveCount)
+			Place(liveCount, std::move(mHeapValues[ePos]), mHeapSlots[ePos], mHeapStamps[ePos]);
+		++liveCount;
+	}
+	mHeapValues.erase(mHeapValues.begin() + liveCount, mHeapValues.end());
+	mHeapSlots.resize(liveCount);
+	mHeapStamps.resize(liveCount);
+	mDeadCount = 0;
+
+	// Then restore the order
+	MakeHeap();
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline unsigned int LazyPriorityQueue<T, Compare, Arity>::FindSlot(const T& e, size_t hash) const
+{
+	return mSlots.Find(hash, [&](unsigned int s) { return (mSlotValues[s] == e); });
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline unsigned int LazyPriorityQueue<T, Compare, Arity>::AllocateSlot()
+{
+	unsigned int slot = mSlots.Allocate();
+	if (slot == mSlotStamps.size())
+		mSlotStamps.push_back(0);
+	return slot;
+}
+
+template<class T, class Compare, unsigned int Arity>
+template<class U>
+inline bool LazyPriorityQueue<T, Compare, Arity>::SetValue(const ElementHandle& handle, U&& newVal)
+{
+	// Return early if the element is gone or belongs to another queue
+	if (handle.mOwnerPt != this || !handle.IsValid())
+		return false;
+
+	// Return early if the element with the new value is already present
+	size_t hash = mHash(newVal);
+	if (FindSlot(newVal, hash) != NO_SLOT)
+		return false;
+
+	// Re-index the slot under the new value
+	unsigned int slot = handle.mSlot;
+	mSlots.Unindex(slot);
+	mSlotValues[slot] = std::forward<U>(newVal);
+	mSlots.Index(slot, hash);
+
+	// Leave the old entry where it is and queue a new one
+	Kill(slot);
+	Push(mSlotValues[slot], slot);
+	CompactIfNeeded();
+	return true;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline bool LazyPriorityQueue<T, Compare, Arity>::Empty() const
+{
+	return mHeapValues.empty();
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t LazyPriorityQueue<T, Compare, Arity>::Size() const
+{
+	return (mHeapValues.size() - mDeadCount);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Reserve(size_t count)
+{
+	mHeapValues.reserve(count);
+	mHeapSlots.reserve(count);
+	mHeapStamps.reserve(count);
+	mSlotValues.reserve(count);
+	mSlotStamps.reserve(count);
+	mSlots.Reserve(count);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::SetCompactionThreshold(float deadFraction)
+{
+	mCompactionThreshold = deadFraction;
+	CompactIfNeeded();
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline typename LazyPriorityQueue<T, Compare, Arity>::ElementHandle LazyPriorityQueue<T, Compare, Arity>::Add(const T& e)
+{
+	// Return early if the element is already present
+	size_t hash = mHash(e);
+	unsigned int slot = FindSlot(e, hash);
+	if (slot != NO_SLOT)
+		return ElementHandle(this, slot);
+
+	// Give it a slot and index it
+	slot = AllocateSlot();
+	if (slot < mSlotValues.size())
+		mSlotValues[slot] = e;
+	else
+		mSlotValues.push_back(e);
+	mSlots.Index(slot, hash);
+
+	// Then queue it
+	Push(e, slot);
+	return ElementHandle(this, slot);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline T LazyPriorityQueue<T, Compare, Arity>::Remove()
+{
+	// Return early if there are no elements
+	if (mHeapValues.empty())
+		return T();
+
+	// The top is always live
+	unsigned int slot = mHeapSlots.front();
+	Pop();
+	++mSlotStamps[slot];
+	mSlots.Free(slot);
+	PruneTop();
+	return std::move(mSlotValues[slot]);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline bool LazyPriorityQueue<T, Compare, Arity>::Erase(const T& e)
+{
+	// Return early if the element is not present
+	unsigned int slot = FindSlot(e, mHash(e));
+	if (slot == NO_SLOT)
+		return false;
+
+	Kill(slot);
+	mSlots.Free(slot);
+	CompactIfNeeded();
+	return true;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline bool LazyPriorityQueue<T, Compare, Arity>::Erase(const ElementHandle& handle)
+{
+	// Return early if the element is gone or belongs to another queue
+	if (handle.mOwnerPt != this || !handle.IsValid())
+		return false;
+
+	Kill(handle.mSlot);
+	mSlots.Free(handle.mSlot);
+	CompactIfNeeded();
+	return true;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline const T& LazyPriorityQueue<T, Compare, Arity>::Peek() const
+{
+	return mSlotValues[mHeapSlots.front()];
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void LazyPriorityQueue<T, Compare, Arity>::Clear()
+{
+	// Free the slots of the live entries so that the outstanding handles become invalid
+	for (size_t ePos = 0; ePos < mHeapValues.size(); ++ePos)
+	{
+		if (!IsLive(ePos))
+			continue;
+		mSlots.Free(mHeapSlots[ePos]);
+	}
+
+	// Clear everything
+	mHeapValues.clear();
+	mHeapSlots.clear();
+	mHeapStamps.clear();
+	mDeadCount = 0;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline typename LazyPriorityQueue<T, Compare, Arity>::ElementHandle LazyPriorityQueue<T, Compare, Arity>::GetElementHandle(const T& e)
+{
+	unsigned int slot = FindSlot(e, mHash(e));
+	if (slot == NO_SLOT)
+		return ElementHandle();
+	return ElementHandle(this, slot);
+}
+
+#endif
@@ -0,0 +1,294 @@
+//***************************************************************
+// MinMaxHeap.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Double-ended heap that gives access to both the smallest and
+// the greatest element, with the order defined by Compare the
+// same way as in PriorityQueue. The levels of the tree
+// alternate between the min levels (each node is smaller than
+// its descendants) and the max levels (each node is greater),
+// so both ends live in one array and take O(log n) to remove.
+// With a capacity set, the heap keeps only the greatest
+// elements (e.g. the best K candidates): adding to a full heap
+// evicts the smallest element, or rejects the new one if that
+// would be the smallest.
+// Like PairingHeap, elements are not indexed by value, so the
+// same value may be added more than once.
+//***************************************************************
+
+#ifndef MIN_MAX_HEAP_H
+#define MIN_MAX_HEAP_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+template <class T, class Compare = std::less<T>>
+class MinMaxHeap
+{
+public:
+	// Constructor
+	// capacity		- maximum number of elements to keep, 0 for no limit
+	MinMaxHeap(size_t capacity = 0, const Compare& comp = Compare());
+
+	// Check whether the heap has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the heap.
+	size_t Size() const;
+
+	// Maximum number of elements, 0 if there is no limit.
+	size_t GetCapacity() const;
+
+	// Reserve space for 'count' elements.
+	void Reserve(size_t count);
+
+	// Add an element to the heap. If the heap is full, the smallest element is evicted
+	// to make room, unless the new element isn't greater than it. Returns false if the
+	// new element was rejected.
+	// Executes in O(log n) time.
+	bool Add(const T& e);
+
+	// Returns the smallest element but does not modify the heap.
+	// Executes in O(1) time.
+	const T& PeekMin() const;
+
+	// Returns the greatest element but does not modify the heap.
+	// Executes in O(1) time.
+	const T& PeekMax() const;
+
+	// Remove the smallest element from the heap, and return it.
+	// Executes in O(log n) time.
+	T RemoveMin();
+
+	// Remove the greatest element from the heap, and return it.
+	// Executes in O(log n) time.
+	T RemoveMax();
+
+	// Clears everything in the heap
+	void Clear();
+
+private:
+	static bool IsMinLevel(size_t ePos);
+	// Position of the greatest element.
+	size_t GetMaxPosition() const;
+	// Comparison from the point of view of the level type: 'less' on the min levels
+	// and 'greater' on the max levels.
+	bool Before(const T& a, const T& b, bool minLevel) const;
+	void BubbleUp(size_t ePos);
+	void BubbleUpLevel(size_t ePos, bool minLevel);
+	void TrickleDown(size_t ePos, bool minLevel);
+	// Takes the element at 'ePos' out, fills the hole with the last element and fixes the heap.
+	T RemoveAt(size_t ePos);
+
+private:
+	std::vector<T> mData;
+	size_t mCapacity;
+	Compare mComp;
+};
+
+template<class T, class Compare>
+inline MinMaxHeap<T, Compare>::MinMaxHeap(size_t capacity, const Compare& comp)
+	: mCapacity(capacity)
+	, mComp(comp)
+{
+	Reserve(capacity);
+}
+
+template<class T, class Compare>
+inline bool MinMaxHeap<T, Compare>::IsMinLevel(size_t ePos)
+{
+	// The level is floor(log2(ePos + 1)), the even ones are the min levels.
+	unsigned int level = 0;
+	for (size_t n = ePos + 1; n > 1; n >>= 1)
+		++level;
+	return ((level & 1) == 0);
+}
+
+template<class T, class Compare>
+inline size_t MinMaxHeap<T, Compare>::GetMaxPosition() const
+{
+	// The greatest element is the root or one of its children
+	if (mData.size() == 1)
+		return 0;
+	if (mData.size() == 2 || mComp(mData[2], mData[1]))
+		return 1;
+	return 2;
+}
+
+template<class T, class Compare>
+inline bool MinMaxHeap<T, Compare>::Before(const T& a, const T& b, bool minLevel) const
+{
+	return (minLevel ? mComp(a, b) : mComp(b, a));
+}
+
+template<class T, class Compare>
+inline void MinMaxHeap<T, Compare>::BubbleUp(size_t ePos)
+{
+	if (ePos == 0)
+		return;
+
+	// First decide which kind of levels the element belongs to by comparing it with the parent
+	bool minLevel = IsMinLevel(ePos);
+	size_t pPos = (ePos - 1) / 2;
+	if (Before(mData[pPos], mData[ePos], minLevel))
+	{
+		std::swap(mData[ePos], mData[pPos]);
+		BubbleUpLevel(pPos, !minLevel);
+	}
+	else
+	{
+		BubbleUpLevel(ePos, minLevel);
+	}
+}
+
+template<class T, class Compare>
+inline void MinMaxHeap<T, Compare>::BubbleUpLevel(size_t ePos, bool minLevel)
+{
+	// Move up through the grandparents, which are on the same kind of level
+	while (ePos > 2)
+	{
+		size_t gpPos = ((ePos - 1) / 2 - 1) / 2;
+		if (!Before(mData[ePos], mData[gpPos], minLevel))
+			break;
+		std::swap(mData[ePos], mData[gpPos]);
+		ePos = gpPos;
+	}
+}
+
+template<class T, class Compare>
+inline void MinMaxHeap<T, Compare>::TrickleDown(size_t ePos, bool minLevel)
+{
+	size_t size = mData.size();
+	while (true)
+	{
+		// Find the first among the children and the grandchildren
+		size_t fcPos = ePos * 2 + 1;
+		if (fcPos >= size)
+			return;
+
+		size_t mPos = fcPos;
+		if (fcPos + 1 < size && Before(mData[fcPos + 1], mData[mPos], minLevel))
+			mPos = fcPos + 1;
+		size_t fgcPos = fcPos * 2 + 1;
+		size_t lastGcPos = std::min(fgcPos + 4, size);
+		for (size_t gcPos = fgcPos; gcPos < lastGcPos; ++gcPos)
+		{
+			if (Before(mData[gcPos], mData[mPos], minLevel))
+				mPos = gcPos;
+		}
+
+		if (!Before(mData[mPos], mData[ePos], minLevel))
+			return;
+		std::swap(mData[mPos], mData[ePos]);
+
+		// A child has no descendants that would need fixing
+		if (mPos < fgcPos)
+			return;
+
+		// The grandchild's parent is on the other kind of level, keep the order with it
+		size_t pPos = (mPos - 1) / 2;
+		if (Before(mData[pPos], mData[mPos], minLevel))
+			std::swap(mData[pPos], mData[mPos]);
+		ePos = mPos;
+	}
+}
+
+template<class T, class Compare>
+inline T MinMaxHeap<T, Compare>::RemoveAt(size_t ePos)
+{
+	T ret = std::move(mData[ePos]);
+	if (ePos != mData.size() - 1)
+		mData[ePos] = std::move(mData.back());
+	mData.pop_back();
+
+	if (ePos < mData.size())
+		TrickleDown(ePos, IsMinLevel(ePos));
+	return ret;
+}
+
+template<class T, class Compare>
+inline bool MinMaxHeap<T, Compare>::Empty() const
+{
+	return mData.empty();
+}
+
+template<class T, class Compare>
+inline size_t MinMaxHeap<T, Compare>::Size() const
+{
+	return mData.size();
+}
+
+template<class T, class Compare>
+inline size_t MinMaxHeap<T, Compare>::GetCapacity() const
+{
+	return mCapacity;
+}
+
+template<class T, class Compare>
+inline void MinMaxHeap<T, Compare>::Reserve(size_t count)
+{
+	mData.reserve(count);
+}
+
+template<class T, class Compare>
+inline bool MinMaxHeap<T, Compare>::Add(const T& e)
+{
+	if (mCapacity != 0 && mData.size() >= mCapacity)
+	{
+		// Return early if the new element would be the one evicted
+		if (!mComp(mData[0], e))
+			return false;
+
+		// Overwrite the smallest element and sink it down from the root
+		mData[0] = e;
+		TrickleDown(0, true);
+		return true;
+	}
+
+	mData.push_back(e);
+	BubbleUp(mData.size() - 1);
+	return true;
+}
+
+template<class T, class Compare>
+inline const T& MinMaxHeap<T, Compare>::PeekMin() const
+{
+	return mData[0];
+}
+
+template<class T, class Compare>
+inline const T& MinMaxHeap<T, Compare>::PeekMax() const
+{
+	return mData[GetMaxPosition()];
+}
+
+template<class T, class Compare>
+inline T MinMaxHeap<T, Compare>::RemoveMin()
+{
+	// Return early if there are no elements
+	if (mData.empty())
+		return T();
+
+	return RemoveAt(0);
+}
+
+template<class T, class Compare>
+inline T MinMaxHeap<T, Compare>::RemoveMax()
+{
+	// Return early if there are no elements
+	if (mData.empty())
+		return T();
+
+	return RemoveAt(GetMaxPosition());
+}
+
+template<class T, class Compare>
+inline void MinMaxHeap<T, Compare>::Clear()
+{
+	mData.clear();
+}
+
+#endif
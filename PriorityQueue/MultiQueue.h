@@ -0,0 +1,213 @@
+//***************************************************************
+// MultiQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Relaxed priority queue for many threads at once. Instead of
+// one heap behind one mutex, the elements are spread over
+// several STL heaps that each have their own lock. Add pushes
+// to a random heap and TryRemove pops from the best of a few
+// randomly sampled heaps, skipping the ones that are busy, so
+// the threads rarely wait on each other. The price is that the
+// removed element is only close to the one with the highest
+// priority, not necessarily that one, which is fine for the
+// parallel best-first searches and schedulers.
+// The quality is tuned with two numbers: the heaps per thread
+// (more heaps mean less contention) and the number of heaps
+// sampled on removal (more samples mean a stricter order).
+// There is no shared counter that every thread would write to:
+// each heap counts its own elements, so the size of the whole
+// queue is only approximate while it is in use.
+//***************************************************************
+
+#ifndef MULTI_QUEUE_H
+#define MULTI_QUEUE_H
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+template <class T, class Compare = std::less<T>>
+class MultiQueue
+{
+public:
+	// Constructor
+	// threadCount		- number of threads expected to use the queue at once
+	// queuesPerThread	- number of internal heaps per thread
+	// sampleCount		- number of heaps to choose the best element from on removal
+	MultiQueue(unsigned int threadCount, unsigned int queuesPerThread = 2, unsigned int sampleCount = 2, const Compare& comp = Compare());
+
+	// Check whether the queue has no elements. Only a hint while other threads are using the queue.
+	// Executes in O(k) time, k being the number of internal heaps.
+	bool Empty() const;
+
+	// Number of elements in the queue, summed over the internal heaps without locking them.
+	// Only approximate while other threads are using the queue.
+	// Executes in O(k) time, k being the number of internal heaps.
+	size_t Size() const;
+
+	// Add an element to the queue. Thread safe.
+	// Executes in O(log n) time.
+	void Add(const T& e);
+
+	// Remove one of the elements with a high priority and write it to 'out'. Thread safe.
+	// Returns false only if the queue was found empty.
+	// Executes in O(log n) time.
+	bool TryRemove(T *out);
+
+	// Clears everything in the queue. Thread safe.
+	void Clear();
+
+private:
+	MultiQueue(const MultiQueue<T, Compare>&);
+	MultiQueue<T, Compare>& operator=(const MultiQueue<T, Compare>&);
+
+	struct InternalQueue
+	{
+		InternalQueue() : mSize(0) {}
+
+		std::mutex mLock;
+		// STL heap
+		std::vector<T> mHeap;
+		// Size of the heap, written under the lock but readable without it
+		std::atomic<size_t> mSize;
+		// Keeps the locks of the neighbouring heaps out of the same cache line
+		char mPadding[64];
+	};
+
+	// Random index of an internal heap, using a generator owned by the calling thread.
+	size_t GetRandomQueue() const;
+	void Pop(InternalQueue& queue, T *out);
+
+private:
+	std::vector<InternalQueue> mQueues;
+	unsigned int mSampleCount;
+	Compare mComp;
+};
+
+template<class T, class Compare>
+inline MultiQueue<T, Compare>::MultiQueue(unsigned int threadCount, unsigned int queuesPerThread, unsigned int sampleCount, const Compare& comp)
+	: mQueues(std::max(threadCount * queuesPerThread, 1u))
+	, mSampleCount(std::max(sampleCount, 1u))
+	, mComp(comp)
+{
+
+}
+
+template<class T, class Compare>
+inline size_t MultiQueue<T, Compare>::GetRandomQueue() const
+{
+	static thread_local std::minstd_rand generator((unsigned int)std::hash<std::thread::id>()(std::this_thread::get_id()));
+	return generator() % mQueues.size();
+}
+
+template<class T, class Compare>
+inline void MultiQueue<T, Compare>::Pop(InternalQueue& queue, T *out)
+{
+	std::pop_heap(queue.mHeap.begin(), queue.mHeap.end(), mComp);
+	*out = std::move(queue.mHeap.back());
+	queue.mHeap.pop_back();
+	queue.mSize.store(queue.mHeap.size(), std::memory_order_relaxed);
+}
+
+template<class T, class Compare>
+inline bool MultiQueue<T, Compare>::Empty() const
+{
+	for (const InternalQueue& queue : mQueues)
+	{
+		if (queue.mSize.load(std::memory_order_relaxed) != 0)
+			return false;
+	}
+	return true;
+}
+
+template<class T, class Compare>
+inline size_t MultiQueue<T, Compare>::Size() const
+{
+	size_t size = 0;
+	for (const InternalQueue& queue : mQueues)
+		size += queue.mSize.load(std::memory_order_relaxed);
+	return size;
+}
+
+template<class T, class Compare>
+inline void MultiQueue<T, Compare>::Add(const T& e)
+{
+	// Keep picking random heaps until a free one is found
+	while (true)
+	{
+		InternalQueue& queue = mQueues[GetRandomQueue()];
+		std::unique_lock<std::mutex> lock(queue.mLock, std::try_to_lock);
+		if (!lock.owns_lock())
+			continue;
+
+		queue.mHeap.push_back(e);
+		std::push_heap(queue.mHeap.begin(), queue.mHeap.end(), mComp);
+		queue.mSize.store(queue.mHeap.size(), std::memory_order_relaxed);
+		return;
+	}
+}
+
+template<class T, class Compare>
+inline bool MultiQueue<T, Compare>::TryRemove(T *out)
+{
+	// Sample a few random heaps and keep the lock only on the best one seen so far.
+	// Busy and empty heaps are skipped, give up on sampling after a few rounds without luck.
+	// The empty ones are recognized by their size alone, without touching their locks.
+	for (size_t attempt = 0; attempt < mQueues.size(); ++attempt)
+	{
+		InternalQueue *bestQueue = nullptr;
+		std::unique_lock<std::mutex> bestLock;
+		for (unsigned int s = 0; s < mSampleCount; ++s)
+		{
+			InternalQueue& queue = mQueues[GetRandomQueue()];
+			if (&queue == bestQueue || queue.mSize.load(std::memory_order_relaxed) == 0)
+				continue;
+
+			std::unique_lock<std::mutex> lock(queue.mLock, std::try_to_lock);
+			if (!lock.owns_lock() || queue.mHeap.empty())
+				continue;
+
+			if (!bestQueue || mComp(bestQueue->mHeap.front(), queue.mHeap.front()))
+			{
+				bestQueue = &queue;
+				bestLock = std::move(lock);
+			}
+		}
+
+		if (bestQueue)
+		{
+			Pop(*bestQueue, out);
+			return true;
+		}
+	}
+
+	// Fall back to visiting every heap in order, waiting for the busy ones
+	for (InternalQueue& queue : mQueues)
+	{
+		if (queue.mSize.load(std::memory_order_relaxed) == 0)
+			continue;
+		std::lock_guard<std::mutex> lock(queue.mLock);
+		if (!queue.mHeap.empty())
+		{
+			Pop(queue, out);
+			return true;
+		}
+	}
+	return false;
+}
+
+template<class T, class Compare>
+inline void MultiQueue<T, Compare>::Clear()
+{
+	for (InternalQueue& queue : mQueues)
+	{
+		std::lock_guard<std::mutex> lock(queue.mLock);
+		queue.mHeap.clear();
+		queue.mSize.store(0, std::memory_order_relaxed);
+	}
+}
+
+#endif
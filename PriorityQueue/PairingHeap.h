@@ -0,0 +1,379 @@
+//***************************************************************
+// PairingHeap.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Pairing heap with the same vocabulary as PriorityQueue
+// (Add, Remove, Peek and handle based updates). Add, moving
+// an element towards the top and melding two heaps take O(1)
+// time, Remove and moving an element away from the top take
+// O(log n) amortized time. That makes it a better fit than
+// PriorityQueue for the workloads dominated by decrease-key.
+// Unlike PriorityQueue, elements are not indexed by value
+// (no hashing at all), so the same value may be added more
+// than once and elements are updated through the handles
+// returned by Add.
+//***************************************************************
+
+#ifndef PAIRING_HEAP_H
+#define PAIRING_HEAP_H
+
+#include <cstddef>
+#include <utility>
+#include <functional>
+
+template <class T, class Compare = std::less<T>>
+class PairingHeap
+{
+private:
+	struct Node
+	{
+		T mValue;
+		// Leftmost child
+		Node *mChild;
+		// Right sibling (or the next node in the free list)
+		Node *mNext;
+		// Left sibling, or the parent for the leftmost child
+		Node *mPrev;
+		// Bumped every time the node is freed, so that the handles to the old element become invalid
+		unsigned int mGeneration;
+	};
+
+public:
+	// Refers to one element of the heap. Stays valid until that element is removed.
+	// Handles are cheap to copy and any number of them may exist at once.
+	class ElementHandle
+	{
+		friend class PairingHeap<T, Compare>;
+
+	public:
+		// Creates a handle that doesn't refer to any element.
+		ElementHandle() : mNode(nullptr), mGeneration(0) {}
+
+		// Check whether the element this handle refers to is still in the heap.
+		bool IsValid() const { return (mNode && mNode->mGeneration == mGeneration); }
+
+		// Returns the element this handle refers to. The handle must be valid.
+		const T& Get() const { return mNode->mValue; }
+
+	private:
+		ElementHandle(Node *node) : mNode(node), mGeneration(node->mGeneration) {}
+		Node *mNode;
+		unsigned int mGeneration;
+	};
+
+public:
+	// Default constructor
+	PairingHeap();
+
+	// Constructor with a comparison function object
+	PairingHeap(const Compare& comp);
+
+	~PairingHeap();
+
+	// Check whether the heap has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the heap.
+	size_t Size() const;
+
+	// Add an element to the heap and return the handle to it.
+	// Executes in O(1) time.
+	ElementHandle Add(const T& e);
+
+	// Remove the element from the heap that has the highest priority, and return it.
+	// Executes in O(log n) amortized time.
+	T Remove();
+
+	// Peek, which returns the highest - priority element but does not modify the heap.
+	// Executes in O(1) time.
+	const T& Peek() const;
+
+	// Updates the element the handle refers to. Returns false if the handle is not valid.
+	// Executes in O(1) time if the element moves towards the top and in O(log n) amortized
+	// time otherwise.
+	bool Update(const ElementHandle& handle, const T& newVal);
+
+	// Moves all of the elements of 'other' into this heap, leaving 'other' empty.
+	// Handles to the elements of 'other' stay valid and are to be used with this heap.
+	// Both heaps need to use the equivalent comparator.
+	// Executes in O(1) time.
+	void Meld(PairingHeap<T, Compare>& other);
+
+	// Clears everything in the heap
+	void Clear();
+
+private:
+	PairingHeap(const PairingHeap<T, Compare>&);
+	PairingHeap<T, Compare>& operator=(const PairingHeap<T, Compare>&);
+
+	Node *AllocateNode(const T& e);
+	void FreeNode(Node *node);
+	// Makes the root with the lower priority the leftmost child of the other one and returns the new root.
+	Node *Link(Node *a, Node *b);
+	// Detaches the subtree rooted at 'node' from its parent.
+	void Cut(Node *node);
+	// Combines a list of siblings into a single tree using the standard two pass method.
+	Node *MergePairs(Node *first);
+	// Moves every node of the tree rooted at 'node' to the free list.
+	void FreeTree(Node *node);
+
+private:
+	Node *mRoot;
+	Node *mFreeList;
+	size_t mSize;
+	Compare mComp;
+};
+
+template<class T, class Compare>
+inline PairingHeap<T, Compare>::PairingHeap()
+	: PairingHeap<T, Compare>(Compare())
+{
+
+}
+
+template<class T, class Compare>
+inline PairingHeap<T, Compare>::PairingHeap(const Compare& comp)
+	: mRoot(nullptr)
+	, mFreeList(nullptr)
+	, mSize(0)
+	, mComp(comp)
+{
+}
+
+template<class T, class Compare>
+inline PairingHeap<T, Compare>::~PairingHeap()
+{
+	Clear();
+	while (mFreeList)
+	{
+		Node *next = mFreeList->mNext;
+		delete mFreeList;
+		mFreeList = next;
+	}
+}
+
+template<class T, class Compare>
+inline typename PairingHeap<T, Compare>::Node *PairingHeap<T, Compare>::AllocateNode(const T& e)
+{
+	// Reuse the freed nodes first
+	Node *node;
+	if (mFreeList)
+	{
+		node = mFreeList;
+		mFreeList = node->mNext;
+		node->mValue = e;
+	}
+	else
+	{
+		node = new Node{ e, nullptr, nullptr, nullptr, 0 };
+	}
+
+	node->mChild = nullptr;
+	node->mNext = nullptr;
+	node->mPrev = nullptr;
+	return node;
+}
+
+template<class T, class Compare>
+inline void PairingHeap<T, Compare>::FreeNode(Node *node)
+{
+	++node->mGeneration;
+	node->mNext = mFreeList;
+	mFreeList = node;
+}
+
+template<class T, class Compare>
+inline typename PairingHeap<T, Compare>::Node *PairingHeap<T, Compare>::Link(Node *a, Node *b)
+{
+	if (!a) return b;
+	if (!b) return a;
+
+	// 'a' stays on top
+	if (mComp(a->mValue, b->mValue))
+		std::swap(a, b);
+
+	b->mNext = a->mChild;
+	if (a->mChild)
+		a->mChild->mPrev = b;
+	b->mPrev = a;
+	a->mChild = b;
+	return a;
+}
+
+template<class T, class Compare>
+inline void PairingHeap<T, Compare>::Cut(Node *node)
+{
+	if (node->mPrev->mChild == node)
+		node->mPrev->mChild = node->mNext; // it's the leftmost child
+	else
+		node->mPrev->mNext = node->mNext;
+
+	if (node->mNext)
+		node->mNext->mPrev = node->mPrev;
+	node->mNext = nullptr;
+	node->mPrev = nullptr;
+}
+
+template<class T, class Compare>
+inline typename PairingHeap<T, Compare>::Node *PairingHeap<T, Compare>::MergePairs(Node *first)
+{
+	if (!first)
+		return nullptr;
+
+	// First pass: link the siblings in pairs, left to right, and push the results on a stack
+	Node *pairs = nullptr;
+	while (first)
+	{
+		Node *a = first;
+		Node *b = a->mNext;
+		a->mPrev = nullptr;
+		if (!b)
+		{
+			a->mNext = pairs;
+			pairs = a;
+			break;
+		}
+
+		first = b->mNext;
+		a->mNext = nullptr;
+		b->mNext = nullptr;
+		b->mPrev = nullptr;
+		Node *linked = Link(a, b);
+		linked->mNext = pairs;
+		pairs = linked;
+	}
+
+	// Second pass: link the pairs right to left
+	Node *result = pairs;
+	pairs = pairs->mNext;
+	result->mNext = nullptr;
+	while (pairs)
+	{
+		Node *node = pairs;
+		pairs = pairs->mNext;
+		node->mNext = nullptr;
+		result = Link(result, node);
+	}
+	return result;
+}
+
+template<class T, class Compare>
+inline void PairingHeap<T, Compare>::FreeTree(Node *node)
+{
+	// Walk the tree without recursion, using the children lists as a stack.
+	while (node)
+	{
+		if (node->mChild)
+		{
+			// Splice the children in front of the siblings that are still to be visited
+			Node *lastChild = node->mChild;
+			while (lastChild->mNext)
+				lastChild = lastChild->mNext;
+			lastChild->mNext = node->mNext;
+			node->mNext = node->mChild;
+			node->mChild = nullptr;
+		}
+
+		Node *next = node->mNext;
+		FreeNode(node);
+		node = next;
+	}
+}
+
+template<class T, class Compare>
+inline bool PairingHeap<T, Compare>::Empty() const
+{
+	return (mRoot == nullptr);
+}
+
+template<class T, class Compare>
+inline size_t PairingHeap<T, Compare>::Size() const
+{
+	return mSize;
+}
+
+template<class T, class Compare>
+inline typename PairingHeap<T, Compare>::ElementHandle PairingHeap<T, Compare>::Add(const T& e)
+{
+	Node *node = AllocateNode(e);
+	mRoot = Link(mRoot, node);
+	++mSize;
+	return ElementHandle(node);
+}
+
+template<class T, class Compare>
+inline T PairingHeap<T, Compare>::Remove()
+{
+	// Return early if there are no elements
+	if (!mRoot)
+		return T();
+
+	Node *oldRoot = mRoot;
+	T ret = std::move(oldRoot->mValue);
+	mRoot = MergePairs(oldRoot->mChild);
+	FreeNode(oldRoot);
+	--mSize;
+	return ret;
+}
+
+template<class T, class Compare>
+inline const T& PairingHeap<T, Compare>::Peek() const
+{
+	return mRoot->mValue;
+}
+
+template<class T, class Compare>
+inline bool PairingHeap<T, Compare>::Update(const ElementHandle& handle, const T& newVal)
+{
+	if (!handle.IsValid())
+		return false;
+
+	Node *node = handle.mNode;
+	bool towardsTop = !mComp(newVal, node->mValue);
+	node->mValue = newVal;
+
+	if (node == mRoot)
+	{
+		// The root only needs fixing if it lost priority
+		if (!towardsTop && node->mChild)
+		{
+			Node *children = node->mChild;
+			node->mChild = nullptr;
+			mRoot = Link(node, MergePairs(children));
+		}
+		return true;
+	}
+
+	Cut(node);
+	if (!towardsTop && node->mChild)
+	{
+		// Its children might have a higher priority now
+		Node *children = node->mChild;
+		node->mChild = nullptr;
+		node = Link(node, MergePairs(children));
+	}
+	mRoot = Link(mRoot, node);
+	return true;
+}
+
+template<class T, class Compare>
+inline void PairingHeap<T, Compare>::Meld(PairingHeap<T, Compare>& other)
+{
+	if (&other == this)
+		return;
+
+	mRoot = Link(mRoot, other.mRoot);
+	mSize += other.mSize;
+	other.mRoot = nullptr;
+	other.mSize = 0;
+}
+
+template<class T, class Compare>
+inline void PairingHeap<T, Compare>::Clear()
+{
+	FreeTree(mRoot);
+	mRoot = nullptr;
+	mSize = 0;
+}
+
+#endif
@@ -1,4 +1,3 @@
-
 //***************************************************************
 // PriorityQueue.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
 //
@@ -8,151 +7,354 @@
 // behind this code. Other than that, using this class
 // should hide away some of the code necessary for STL
 // heap to work. Similar to std::priority_queue.
+// The comparator is a template parameter so that it can be
+// inlined, same as with std::priority_queue (use
+// std::function as Compare if it has to be set at runtime).
+// Arity sets the number of children per node. Wider heaps
+// (4 or 8) are shallower and keep the children of a node next
+// to each other in memory, which pays off for large queues.
+// The heap array is allocated so that the children of a node
+// share a cache line whenever Arity * sizeof(T) divides it.
+// Every element occupies a slot that doesn't move while the
+// element is in the queue. Handles refer to the slots, so any
+// number of them can be kept around while the queue changes.
+// Elements are stored only once: the lookup by value goes
+// through their hashes, so T may also be a move-only type.
+// The hashes are indexed in a flat open-addressing table, so
+// there is no allocation per element and no pointer chasing.
 //***************************************************************
 
 #ifndef PRIORITY_QUEUE_H
 #define PRIORITY_QUEUE_H
 
 #include <vector>
-#include <unordered_map>
+#include <utility>
 #include <algorithm>
 #include <functional>
+#include "HeapChildSelect.h"
+#include "HeapGroupAllocator.h"
+#include "SlotTable.h"
 
-template <class T>
+template <class T, class Compare = std::less<T>, unsigned int Arity = 2>
 class PriorityQueue
 {
+	static_assert(Arity >= 2, "The heap needs at least two children per node.");
+
 	friend class ElementHandle;
 
 public:
+	// Refers to one element of the queue. Stays valid until that element is removed
+	// from the queue, regardless of what happens to the other elements.
+	// Handles are cheap to copy and any number of them may exist at once.
 	class ElementHandle
 	{
-		friend class PriorityQueue<T>;
+		friend class PriorityQueue<T, Compare, Arity>;
 
 	public:
-		~ElementHandle();
-		
+		// Creates a handle that doesn't refer to any element.
+		ElementHandle();
+
+		// Check whether the element this handle refers to is still in the queue.
+		bool IsValid() const;
+
+		// Returns the element this handle refers to. The handle must be valid.
+		const T& Get() const;
+
 		// Updates the element to a new value and then updates the
 		// containing queue. Returns true if successful.
+		// Executes in O(log n) time.
 		bool Update(const T& newVal);
+		bool Update(T&& newVal);
 
 	private:
-		ElementHandle(PriorityQueue<T> *ownerPt, size_t thisPos);
-		PriorityQueue<T> *const mOwnerPt;
-		size_t mThisPos;
+		ElementHandle(PriorityQueue<T, Compare, Arity> *ownerPt, size_t slot);
+		PriorityQueue<T, Compare, Arity> *mOwnerPt;
+		size_t mSlot;
+		unsigned int mGeneration;
 	};
 
 public:
 	// Default constructor
 	PriorityQueue();
 
-	// Constructor with a comparison function
-	PriorityQueue(const std::function<bool(T, T)>& comp);
+	// Constructor with a comparison function object
+	PriorityQueue(const Compare& comp);
+
+	// Constructor that fills the queue with the elements from [first, last).
+	// Executes in O(n) time.
+	template<class InputIt>
+	PriorityQueue(InputIt first, InputIt last, const Compare& comp = Compare());
 
 	// Check whether the queue has no elements.
 	// Executes in O(1) time.
 	bool Empty() const;
 
-	// Add an element to the queue with an associated priority.
+	// Add an element to the queue with an associated priority and return the handle to it.
+	// If the element is already present, the handle to the existing one is returned.
 	// Executes in O(log n) time on average.
-	void Add(const T& e);
-
-	// Remove the element from the queue that has the highest priority, and return it.
-	// Executes in O(1) time.
+	ElementHandle Add(const T& e);
+	ElementHandle Add(T&& e);
+
+	// Same as Add, but constructs the element from 'args' in place, at the back of the heap.
+	// If an equal element is already present, the new one is destroyed again.
+	template<class... Args>
+	ElementHandle Emplace(Args&&... args);
+
+	// Add all of the elements from [first, last). Duplicates are skipped.
+	// When the range is large compared to the queue, the whole heap is rebuilt
+	// in O(n) time instead of adding elements one by one in O(k log n) time.
+	template<class InputIt>
+	void AddRange(InputIt first, InputIt last);
+
+	// Reserve space for 'count' elements.
+	void Reserve(size_t count);
+
+	// Remove the element from the queue that has the highest priority, and move it out.
+	// Returns T() if the queue is empty, so T has to be default-constructible for this one.
+	// Executes in O(log n) time.
 	T Remove();
 
+	// Same as above, but moves the element into 'out'. Returns false if the queue is empty.
+	bool Remove(T& out);
+
+	// Remove the element with the given value from the queue. Returns false if it is not present.
+	// Executes in O(log n) time on average.
+	bool Erase(const T& e);
+
+	// Remove the element the handle refers to from the queue. Returns false if the handle is not valid.
+	// Executes in O(log n) time.
+	bool Erase(const ElementHandle& handle);
+
 	// Peek, which returns the highest - priority element but does not modify the queue.
 	// Executes in O(1) time.
-	T Peek() const;
+	const T& Peek() const;
 
 	// Clears everything in the queue
 	void Clear();
 
-	// Get a handle that will allow to update elements in the heap
+	// Get a handle that will allow to update elements in the heap.
+	// The handle is not valid if the element is not in the queue.
 	ElementHandle GetElementHandle(const T& e);
 
+	// Applies a batch of updates, given as (ElementHandle, new value) pairs, and returns the
+	// number of the successful ones. An update fails for the same reasons as ElementHandle::Update.
+	// When the batch is large compared to the queue, the whole heap is rebuilt in O(n) time
+	// instead of fixing the elements one by one in O(k log n) time.
+	template<class InputIt>
+	size_t UpdateMany(InputIt first, InputIt last);
+
 private:
 	size_t GetParentPosition(size_t child);
-	size_t GetLeftChildPosition(size_t parent);
-	size_t GetRightChildPosition(size_t parent);
+	size_t GetFirstChildPosition(size_t parent);
 	void Swap(size_t e1, size_t e2);
 	void UpdatePriority(size_t ePos);
+	// Appends the element to the back of the heap without fixing it, unless it is already present.
+	// Returns the slot of the new or the existing element.
+	template<class U>
+	size_t Append(U&& e, bool *added);
+	// Gives the element at the back of the heap a slot and indexes it. Returns the slot.
+	size_t IndexBack(size_t hash);
+	// Takes the element at 'ePos' out of the queue, fills the hole with the last element and fixes the heap.
+	T RemoveAt(size_t ePos);
+	// Changes the value of the element the handle refers to without fixing the heap.
+	// Returns false if the handle is not valid or the new value is already present.
+	template<class U>
+	bool SetValue(const ElementHandle& handle, U&& newVal);
+	// Returns the slot of the element equal to 'e' or NO_SLOT if there is none.
+	size_t FindSlot(const T& e, size_t hash) const;
+	size_t BubbleUp(size_t ePos);
+	void BubbleDown(size_t ePos);
+	// Restores the heap property of the whole heap in O(n) time.
+	void MakeHeap();
+	// Whether fixing 'count' elements one by one is more expensive than MakeHeap.
+	bool PreferMakeHeap(size_t count) const;
+	size_t AllocateSlot(size_t ePos);
+	void FreeSlot(size_t slot);
 
 private:
-	std::vector<T> mData;
-	std::unordered_map<T, size_t> mValToPos;
-	std::function<bool(T, T)> mComp;
-	int mLock;
+	static const size_t NO_SLOT = SlotTable<size_t>::NO_SLOT;
+
+	// Elements in the heap order, laid out so that sibling groups start on cache line boundaries
+	std::vector<T, HeapGroupAllocator<T>> mData;
+	// Slot of the element at the same position in mData
+	std::vector<size_t> mHeapSlots;
+	// Position in mData of the element occupying each slot
+	std::vector<size_t> mSlotPos;
+	// Generations and hashes of the slots, the elements themselves are compared in mData
+	SlotTable<size_t> mSlots;
+	std::hash<T> mHash;
+	Compare mComp;
 };
 
-template<class T>
-inline PriorityQueue<T>::PriorityQueue()
-	: PriorityQueue<T>(std::less<int>())
+template<class T, class Compare, unsigned int Arity>
+const size_t PriorityQueue<T, Compare, Arity>::NO_SLOT;
+
+template<class T, class Compare, unsigned int Arity>
+inline PriorityQueue<T, Compare, Arity>::PriorityQueue()
+	: PriorityQueue<T, Compare, Arity>(Compare())
 {
 
 }
 
-template<class T>
-inline PriorityQueue<T>::PriorityQueue(const std::function<bool(T, T)>& comp)
+template<class T, class Compare, unsigned int Arity>
+inline PriorityQueue<T, Compare, Arity>::PriorityQueue(const Compare& comp)
 	: mComp(comp)
-	, mLock(0)
 {
 }
 
-template<class T>
-inline size_t PriorityQueue<T>::GetParentPosition(size_t child)
+template<class T, class Compare, unsigned int Arity>
+template<class InputIt>
+inline PriorityQueue<T, Compare, Arity>::PriorityQueue(InputIt first, InputIt last, const Compare& comp)
+	: mComp(comp)
 {
-	return ((child - 1) / 2);
+	AddRange(first, last);
 }
 
-template<class T>
-inline size_t PriorityQueue<T>::GetLeftChildPosition(size_t parent)
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::GetParentPosition(size_t child)
 {
-	return (parent * 2 + 1);
+	return ((child - 1) / Arity);
 }
 
-template<class T>
-inline size_t PriorityQueue<T>::GetRightChildPosition(size_t parent)
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::GetFirstChildPosition(size_t parent)
 {
-	return (parent * 2 + 2);
+	return (parent * Arity + 1);
 }
 
-template<class T>
-inline void PriorityQueue<T>::Swap(size_t e1, size_t e2)
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::Swap(size_t e1, size_t e2)
 {
-	T& e1V = mData[e1];
-	T& e2V = mData[e2];
-	std::swap(mValToPos[e1V], mValToPos[e2V]);
-	std::swap(e1V, e2V);
+	// Slots stay with their elements, only the positions of the two slots change.
+	std::swap(mData[e1], mData[e2]);
+	std::swap(mHeapSlots[e1], mHeapSlots[e2]);
+	mSlotPos[mHeapSlots[e1]] = e1;
+	mSlotPos[mHeapSlots[e2]] = e2;
 }
 
-template<class T>
-inline void PriorityQueue<T>::UpdatePriority(size_t ePos)
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::AllocateSlot(size_t ePos)
+{
+	size_t slot = mSlots.Allocate();
+	if (slot == mSlotPos.size())
+		mSlotPos.push_back(ePos);
+	else
+		mSlotPos[slot] = ePos;
+	return slot;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::FreeSlot(size_t slot)
+{
+	mSlots.Free(slot);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::UpdatePriority(size_t ePos)
+{
+	// Bubble it up or down
+	BubbleDown(BubbleUp(ePos));
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::FindSlot(const T& e, size_t hash) const
+{
+	return mSlots.Find(hash, [&](unsigned int s) { return (mData[mSlotPos[s]] == e); });
+}
+
+template<class T, class Compare, unsigned int Arity>
+template<class U>
+inline bool PriorityQueue<T, Compare, Arity>::SetValue(const ElementHandle& handle, U&& newVal)
+{
+	// Return early if the element is gone or belongs to another queue
+	if (handle.mOwnerPt != this || !handle.IsValid())
+		return false;
+
+	// Return early if the element with the new value is already present 
+	size_t hash = mHash(newVal);
+	if (FindSlot(newVal, hash) != NO_SLOT)
+		return false;
+
+	// Erase it from the index
+	size_t slot = handle.mSlot;
+	mSlots.Unindex(slot);
+
+	// Update and add the new entry to the index
+	mData[mSlotPos[slot]] = std::forward<U>(newVal);
+	mSlots.Index(slot, hash);
+	return true;
+}
+
+template<class T, class Compare, unsigned int Arity>
+template<class U>
+inline size_t PriorityQueue<T, Compare, Arity>::Append(U&& e, bool *added)
+{
+	// Return early if the element is already present 
+	size_t hash = mHash(e);
+	size_t slot = FindSlot(e, hash);
+	*added = (slot == NO_SLOT);
+	if (!*added)
+		return slot;
+
+	// Add it to the back of the heap
+	mData.push_back(std::forward<U>(e));
+	return IndexBack(hash);
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::IndexBack(size_t hash)
+{
+	size_t slot = AllocateSlot(mData.size() - 1);
+	mHeapSlots.push_back(slot);
+	mSlots.Index(slot, hash);
+	return slot;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline T PriorityQueue<T, Compare, Arity>::RemoveAt(size_t ePos)
+{
+	// Swap the element with the last element in the queue
+	// (whilst keeping track of slot positions)
+	Swap(ePos, mData.size() - 1);
+
+	// Move the element (now at the back) out and free its slot
+	T ret = std::move(mData.back());
+	FreeSlot(mHeapSlots.back());
+	mData.pop_back();
+	mHeapSlots.pop_back();
+
+	// Update the priority of the element moved into the hole, it can go either way
+	if (ePos < mData.size())
+		UpdatePriority(ePos);
+	return ret;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline size_t PriorityQueue<T, Compare, Arity>::BubbleUp(size_t ePos)
 {
-	// Bubble it up
 	while (ePos != 0 && mComp(mData[GetParentPosition(ePos)], mData[ePos]))
 	{
 		size_t pPos = GetParentPosition(ePos);
 		Swap(pPos, ePos);
 		ePos = pPos;
 	}
+	return ePos;
+}
 
-	// Or bubble down
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::BubbleDown(size_t ePos)
+{
 	while (true)
 	{
-		size_t lcPos = GetLeftChildPosition(ePos);
-		size_t rcPos = GetRightChildPosition(ePos);
-		size_t higherPriorityChildPos;
-		// The left child is out of bounds, meaning the right one is too
+		size_t fcPos = GetFirstChildPosition(ePos);
+		// The first child is out of bounds, meaning the others are too
 		// in which case we are done
-		if (lcPos >= mData.size())
+		if (fcPos >= mData.size())
 			break;
-		// The right child is out of bounds, meaning the left one is the only option
-		else if (rcPos >= mData.size())
-			higherPriorityChildPos = lcPos;
-		// Both children are within the bounds, meaning we need to prioritize
-		// between them.
-		else
-			higherPriorityChildPos = (mComp(mData[lcPos], mData[rcPos])) ? rcPos : lcPos;
+
+		// Prioritize between the children that are within the bounds.
+		size_t lastPos = std::min(fcPos + Arity, mData.size());
+		size_t higherPriorityChildPos = fcPos + SelectHeapChild<Arity>(&mData[fcPos], lastPos - fcPos, mComp);
 
 		if (mComp(mData[ePos], mData[higherPriorityChildPos]))
 		{
@@ -164,122 +366,255 @@ inline void PriorityQueue<T>::UpdatePriority(size_t ePos)
 	}
 }
 
-template<class T>
-inline bool PriorityQueue<T>::Empty() const
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::MakeHeap()
 {
-	return mData.empty();
+	// Floyd's method: sink every inner node, starting from the last one.
+	if (mData.size() < 2)
+		return;
+	for (size_t ePos = GetParentPosition(mData.size() - 1) + 1; ePos-- > 0;)
+		BubbleDown(ePos);
 }
 
-template<class T>
-inline void PriorityQueue<T>::Add(const T& e)
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::PreferMakeHeap(size_t count) const
 {
-	// Throw if we already have active handles
-	if (mLock >= 1) throw;
+	// Bubbling costs up to a level per step, MakeHeap costs about one step per element.
+	size_t depth = 1;
+	for (size_t levelEnd = 1; levelEnd < mData.size(); levelEnd = levelEnd * Arity + 1)
+		++depth;
+	return (count * depth > mData.size());
+}
 
-	// Return early if the element is already present 
-	if (mValToPos.find(e) != mValToPos.end())
-		return;
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::Empty() const
+{
+	return mData.empty();
+}
 
-	// Get the initial element position
-	size_t ePos = mData.size();
+template<class T, class Compare, unsigned int Arity>
+inline typename PriorityQueue<T, Compare, Arity>::ElementHandle PriorityQueue<T, Compare, Arity>::Add(const T& e)
+{
+	bool added;
+	size_t slot = Append(e, &added);
 
-	// Add it to the heap
-	mData.push_back(e);
+	// Update the priority of the newly added element
+	if (added)
+		UpdatePriority(mData.size() - 1);
+	return ElementHandle(this, slot);
+}
 
-	// Save it's position
-	mValToPos[e] = ePos;
+template<class T, class Compare, unsigned int Arity>
+inline typename PriorityQueue<T, Compare, Arity>::ElementHandle PriorityQueue<T, Compare, Arity>::Add(T&& e)
+{
+	bool added;
+	size_t slot = Append(std::move(e), &added);
 
 	// Update the priority of the newly added element
-	UpdatePriority(ePos);
+	if (added)
+		UpdatePriority(mData.size() - 1);
+	return ElementHandle(this, slot);
+}
+
+template<class T, class Compare, unsigned int Arity>
+template<class... Args>
+inline typename PriorityQueue<T, Compare, Arity>::ElementHandle PriorityQueue<T, Compare, Arity>::Emplace(Args&&... args)
+{
+	// The element has to exist before it can be hashed and compared with the others,
+	// so it's constructed at the back of the heap and taken out again if it's a duplicate.
+	mData.emplace_back(std::forward<Args>(args)...);
+	size_t hash = mHash(mData.back());
+	size_t slot = FindSlot(mData.back(), hash);
+	if (slot != NO_SLOT)
+	{
+		mData.pop_back();
+		return ElementHandle(this, slot);
+	}
+
+	// Index it and update the priority of the newly added element
+	slot = IndexBack(hash);
+	UpdatePriority(mData.size() - 1);
+	return ElementHandle(this, slot);
+}
+
+template<class T, class Compare, unsigned int Arity>
+template<class InputIt>
+inline void PriorityQueue<T, Compare, Arity>::AddRange(InputIt first, InputIt last)
+{
+	size_t oldSize = mData.size();
+	Reserve(oldSize + (size_t)std::distance(first, last));
+
+	// Append the new elements without fixing the heap
+	for (; first != last; ++first)
+	{
+		bool added;
+		Append(*first, &added);
+	}
+
+	// Then fix it in whichever way is cheaper
+	size_t count = mData.size() - oldSize;
+	if (PreferMakeHeap(count))
+		MakeHeap();
+	else
+	{
+		for (size_t ePos = oldSize; ePos < mData.size(); ++ePos)
+			BubbleUp(ePos);
+	}
 }
 
-template<class T>
-inline T PriorityQueue<T>::Remove()
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::Reserve(size_t count)
 {
-	// Throw if we already have active handles
-	if (mLock >= 1) throw;
+	mData.reserve(count);
+	mHeapSlots.reserve(count);
+	mSlotPos.reserve(count);
+	mSlots.Reserve(count);
+}
 
+template<class T, class Compare, unsigned int Arity>
+inline T PriorityQueue<T, Compare, Arity>::Remove()
+{
 	// Return early if there are no elements
-	if (mValToPos.empty())
+	if (mData.empty())
 		return T();
 
-	// Get the highest priority element and swap it with the last
-	// element in the queue (whilst keeping track of value-to-position map)
-	Swap(0, mData.size() - 1);
+	// Return the best element
+	return RemoveAt(0);
+}
 
-	// Get a copy of the highest priority element (now at the back)
-	T ret = mData.back();
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::Remove(T& out)
+{
+	// Return early if there are no elements
+	if (mData.empty())
+		return false;
 
-	// Remove the last element
-	mValToPos.erase(ret);
-	mData.pop_back();
+	out = RemoveAt(0);
+	return true;
+}
 
-	// Update the priority of the newly moved element at the top
-	UpdatePriority(0);
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::Erase(const T& e)
+{
+	// Return early if the element is not present
+	size_t slot = FindSlot(e, mHash(e));
+	if (slot == NO_SLOT)
+		return false;
 
-	// Return the best element
-	return ret;
+	RemoveAt(mSlotPos[slot]);
+	return true;
 }
 
-template<class T>
-inline T PriorityQueue<T>::Peek() const
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::Erase(const ElementHandle& handle)
+{
+	// Return early if the element is gone or belongs to another queue
+	if (handle.mOwnerPt != this || !handle.IsValid())
+		return false;
+
+	RemoveAt(mSlotPos[handle.mSlot]);
+	return true;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline const T& PriorityQueue<T, Compare, Arity>::Peek() const
 {
 	return mData.front();
 }
 
-template<class T>
-inline void PriorityQueue<T>::Clear()
+template<class T, class Compare, unsigned int Arity>
+inline void PriorityQueue<T, Compare, Arity>::Clear()
 {
-	// Throw if we already have active handles
-	if (mLock >= 1) throw;
+	// Free the slots so that the outstanding handles become invalid
+	for (size_t slot : mHeapSlots)
+		FreeSlot(slot);
 
 	// Clear everything
 	mData.clear();
-	mValToPos.clear();
+	mHeapSlots.clear();
+}
+
+template<class T, class Compare, unsigned int Arity>
+typename PriorityQueue<T, Compare, Arity>::ElementHandle PriorityQueue<T, Compare, Arity>::GetElementHandle(const T& e)
+{
+	size_t slot = FindSlot(e, mHash(e));
+	if (slot == NO_SLOT)
+		return ElementHandle();
+	return ElementHandle(this, slot);
 }
 
-template<class T>
-typename PriorityQueue<T>::ElementHandle PriorityQueue<T>::GetElementHandle(const T& e)
+template<class T, class Compare, unsigned int Arity>
+template<class InputIt>
+inline size_t PriorityQueue<T, Compare, Arity>::UpdateMany(InputIt first, InputIt last)
+{
+	// Large batches change all of the values first and then rebuild the heap
+	size_t updated = 0;
+	if (PreferMakeHeap((size_t)std::distance(first, last)))
+	{
+		for (; first != last; ++first)
+			updated += SetValue(first->first, first->second);
+		MakeHeap();
+		return updated;
+	}
+
+	// Small ones fix the heap after every change, since it can only be fixed from one broken spot at a time
+	for (; first != last; ++first)
+	{
+		if (!SetValue(first->first, first->second))
+			continue;
+		UpdatePriority(mSlotPos[first->first.mSlot]);
+		++updated;
+	}
+	return updated;
+}
+
+template<class T, class Compare, unsigned int Arity>
+inline PriorityQueue<T, Compare, Arity>::ElementHandle::ElementHandle()
+	: mOwnerPt(nullptr)
+	, mSlot(0)
+	, mGeneration(0)
 {
-	size_t ePos = mValToPos[e];
-	return ElementHandle(this, ePos);
 }
 
-template<class T>
-inline PriorityQueue<T>::ElementHandle::ElementHandle(PriorityQueue<T>* ownerPt, size_t thisPos)
+template<class T, class Compare, unsigned int Arity>
+inline PriorityQueue<T, Compare, Arity>::ElementHandle::ElementHandle(PriorityQueue<T, Compare, Arity>* ownerPt, size_t slot)
 	: mOwnerPt(ownerPt)
-	, mThisPos(thisPos)
+	, mSlot(slot)
+	, mGeneration(ownerPt->mSlots.GetGeneration(slot))
 {
-	mOwnerPt->mLock++;
+}
 
-	// Throw if the number of handles is greater than one
-	if (mOwnerPt->mLock > 1) throw;
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::ElementHandle::IsValid() const
+{
+	return (mOwnerPt && mOwnerPt->mSlots.GetGeneration(mSlot) == mGeneration);
 }
 
-template<class T>
-inline PriorityQueue<T>::ElementHandle::~ElementHandle()
+template<class T, class Compare, unsigned int Arity>
+inline const T& PriorityQueue<T, Compare, Arity>::ElementHandle::Get() const
 {
-	mOwnerPt->mLock--;
+	return mOwnerPt->mData[mOwnerPt->mSlotPos[mSlot]];
 }
 
-template<class T>
-inline bool PriorityQueue<T>::ElementHandle::Update(const T &newVal)
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::ElementHandle::Update(const T &newVal)
 {
-	// Return early if the element with the new value is already present 
-	if (mOwnerPt->mValToPos.find(newVal) != mOwnerPt->mValToPos.end())
+	if (!mOwnerPt || !mOwnerPt->SetValue(*this, newVal))
 		return false;
 
-	// Erase it from the map
-	T& oldVal = mOwnerPt->mData[mThisPos];
-	mOwnerPt->mValToPos.erase(oldVal);
+	// Fix the heap, the slot follows the element
+	mOwnerPt->UpdatePriority(mOwnerPt->mSlotPos[mSlot]);
+	return true;
+}
 
-	// Update and add the new enty to the map
-	mOwnerPt->mData[mThisPos] = newVal;
-	mOwnerPt->mValToPos[newVal] = mThisPos;
+template<class T, class Compare, unsigned int Arity>
+inline bool PriorityQueue<T, Compare, Arity>::ElementHandle::Update(T &&newVal)
+{
+	if (!mOwnerPt || !mOwnerPt->SetValue(*this, std::move(newVal)))
+		return false;
 
-	// Fix the heap and update the index of this element
-	mOwnerPt->UpdatePriority(mThisPos);
-	mThisPos = mOwnerPt->mValToPos[newVal];
+	// Fix the heap, the slot follows the element
+	mOwnerPt->UpdatePriority(mOwnerPt->mSlotPos[mSlot]);
 	return true;
 }
 
@@ -0,0 +1,298 @@
+//***************************************************************
+// RadixHeap.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Min-queue for unsigned integer priorities that are
+// monotone: a priority that is added or updated to may never
+// be smaller than the last one removed (or peeked), which is
+// the case for Dijkstra-like searches. Elements are grouped
+// into buckets by the highest bit in which their priority
+// differs from the last removed one, so every element is moved
+// between buckets at most once per bit - O(log C) amortized
+// per operation, with C being the largest priority, and mostly
+// sequential memory access.
+// It has the same interface as IndexedPriorityQueue (elements
+// are dense integer ids), so it can be plugged into
+// Graph::Dijkstra or any other search written against it.
+//***************************************************************
+
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+template <class Priority = unsigned int>
+class RadixHeap
+{
+	static_assert(std::numeric_limits<Priority>::is_integer && !std::numeric_limits<Priority>::is_signed,
+		"RadixHeap needs an unsigned integer priority type.");
+
+public:
+	// Default constructor
+	RadixHeap();
+
+	// Constructor that reserves space for ids in the range [0, idCount).
+	RadixHeap(unsigned int idCount);
+
+	// Reserves space for ids in the range [0, idCount). Larger ids are still
+	// accepted, the arrays simply grow when they are added.
+	void Reserve(unsigned int idCount);
+
+	// Check whether the heap has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the heap.
+	size_t Size() const;
+
+	// Check whether the id is in the heap.
+	// Executes in O(1) time.
+	bool Contains(unsigned int id) const;
+
+	// Add an id to the heap with an associated priority. Does nothing if the id is already present.
+	// The priority may not be smaller than the last removed or peeked one.
+	// Executes in O(1) time.
+	void Add(unsigned int id, const Priority& priority);
+
+	// Remove the id with the smallest priority, and return it.
+	// Executes in O(log C) amortized time.
+	unsigned int Remove();
+
+	// Peek, which returns the id with the smallest priority but does not modify the heap.
+	// Executes in O(log C) amortized time.
+	unsigned int Peek() const;
+
+	// Returns the smallest priority in the heap.
+	// Executes in O(log C) amortized time.
+	const Priority& PeekPriority() const;
+
+	// Returns the priority of an id that is in the heap.
+	// Executes in O(1) time.
+	const Priority& GetPriority(unsigned int id) const;
+
+	// Changes the priority of an id that is in the heap. The priority may not be smaller
+	// than the last removed or peeked one. Returns false if the id is not in the heap.
+	// Executes in O(1) time.
+	bool Update(unsigned int id, const Priority& priority);
+
+	// Clears everything in the heap. Only touches the ids that are in the heap.
+	void Clear();
+
+private:
+	static const unsigned int NOT_IN_HEAP = ~0u;
+	static const unsigned int BUCKET_COUNT = std::numeric_limits<Priority>::digits + 1;
+
+	// Index of the highest bit in which the priority differs from the last removed one, plus one.
+	unsigned int GetBucketIndex(const Priority& priority) const;
+	void Insert(unsigned int id, unsigned int bucket) const;
+	void Erase(unsigned int id);
+	// Makes sure that the smallest priority is in the first bucket, by redistributing
+	// the first non-empty bucket if needed. This only reorganizes the buckets, so the
+	// const peeks may call it as well.
+	void Refill() const;
+
+private:
+	mutable std::vector<unsigned int> mBuckets[BUCKET_COUNT];
+	std::vector<Priority> mPriorities;
+	mutable std::vector<unsigned int> mIdToBucket;
+	mutable std::vector<unsigned int> mIdToIndex;
+	// The last removed or peeked priority
+	mutable Priority mLast;
+	size_t mSize;
+};
+
+template<class Priority>
+const unsigned int RadixHeap<Priority>::NOT_IN_HEAP;
+
+template<class Priority>
+inline RadixHeap<Priority>::RadixHeap()
+	: RadixHeap<Priority>(0)
+{
+
+}
+
+template<class Priority>
+inline RadixHeap<Priority>::RadixHeap(unsigned int idCount)
+	: mLast(0)
+	, mSize(0)
+{
+	Reserve(idCount);
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Reserve(unsigned int idCount)
+{
+	if (idCount > mIdToBucket.size())
+	{
+		mPriorities.resize(idCount);
+		mIdToBucket.resize(idCount, NOT_IN_HEAP);
+		mIdToIndex.resize(idCount);
+	}
+}
+
+template<class Priority>
+inline unsigned int RadixHeap<Priority>::GetBucketIndex(const Priority& priority) const
+{
+	unsigned long long diff = (unsigned long long)(priority ^ mLast);
+	if (diff == 0)
+		return 0;
+#if defined(__GNUC__)
+	return 64 - __builtin_clzll(diff);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, diff);
+	return index + 1;
+#else
+	unsigned int index = 0;
+	while (diff) { ++index; diff >>= 1; }
+	return index;
+#endif
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Insert(unsigned int id, unsigned int bucket) const
+{
+	mIdToBucket[id] = bucket;
+	mIdToIndex[id] = (unsigned int)mBuckets[bucket].size();
+	mBuckets[bucket].push_back(id);
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Erase(unsigned int id)
+{
+	// Fill the hole with the last id in the bucket
+	std::vector<unsigned int>& bucket = mBuckets[mIdToBucket[id]];
+	unsigned int index = mIdToIndex[id];
+	unsigned int lastId = bucket.back();
+	bucket[index] = lastId;
+	mIdToIndex[lastId] = index;
+	bucket.pop_back();
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Refill() const
+{
+	if (!mBuckets[0].empty() || mSize == 0)
+		return;
+
+	// Find the first non-empty bucket and its smallest priority
+	unsigned int b = 1;
+	while (mBuckets[b].empty())
+		++b;
+	std::vector<unsigned int>& bucket = mBuckets[b];
+	Priority newLast = mPriorities[bucket[0]];
+	for (unsigned int id : bucket)
+		newLast = (mPriorities[id] < newLast) ? mPriorities[id] : newLast;
+
+	// Every element of that bucket now differs from the new minimum in a lower bit only
+	mLast = newLast;
+	std::vector<unsigned int> moved;
+	moved.swap(bucket);
+	for (unsigned int id : moved)
+		Insert(id, GetBucketIndex(mPriorities[id]));
+
+	// Keep the bucket's memory around for reuse
+	moved.clear();
+	bucket.swap(moved);
+}
+
+template<class Priority>
+inline bool RadixHeap<Priority>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class Priority>
+inline size_t RadixHeap<Priority>::Size() const
+{
+	return mSize;
+}
+
+template<class Priority>
+inline bool RadixHeap<Priority>::Contains(unsigned int id) const
+{
+	return (id < mIdToBucket.size() && mIdToBucket[id] != NOT_IN_HEAP);
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Add(unsigned int id, const Priority& priority)
+{
+	// Return early if the id is already present
+	if (Contains(id))
+		return;
+
+	assert(priority >= mLast);
+	if (id >= mIdToBucket.size())
+		Reserve(id + 1);
+
+	mPriorities[id] = priority;
+	Insert(id, GetBucketIndex(priority));
+	++mSize;
+}
+
+template<class Priority>
+inline unsigned int RadixHeap<Priority>::Remove()
+{
+	assert(!Empty() && "Remove on an empty heap.");
+	Refill();
+	unsigned int ret = mBuckets[0].back();
+	mBuckets[0].pop_back();
+	mIdToBucket[ret] = NOT_IN_HEAP;
+	--mSize;
+	return ret;
+}
+
+template<class Priority>
+inline unsigned int RadixHeap<Priority>::Peek() const
+{
+	assert(!Empty() && "Peek on an empty heap.");
+	Refill();
+	return mBuckets[0].back();
+}
+
+template<class Priority>
+inline const Priority& RadixHeap<Priority>::PeekPriority() const
+{
+	assert(!Empty() && "Peek on an empty heap.");
+	Refill();
+	return mPriorities[mBuckets[0].back()];
+}
+
+template<class Priority>
+inline const Priority& RadixHeap<Priority>::GetPriority(unsigned int id) const
+{
+	return mPriorities[id];
+}
+
+template<class Priority>
+inline bool RadixHeap<Priority>::Update(unsigned int id, const Priority& priority)
+{
+	if (!Contains(id))
+		return false;
+
+	assert(priority >= mLast);
+	Erase(id);
+	mPriorities[id] = priority;
+	Insert(id, GetBucketIndex(priority));
+	return true;
+}
+
+template<class Priority>
+inline void RadixHeap<Priority>::Clear()
+{
+	for (unsigned int b = 0; b < BUCKET_COUNT; ++b)
+	{
+		for (unsigned int id : mBuckets[b])
+			mIdToBucket[id] = NOT_IN_HEAP;
+		mBuckets[b].clear();
+	}
+	mLast = 0;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,280 @@
+//***************************************************************
+// SequenceHeap.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Priority queue for very large numbers of elements, where a
+// binary heap would miss the cache on almost every level.
+// New elements go into a small insertion heap that stays in
+// the cache. When it fills up, it is sorted into a run, and
+// runs are merged level by level (16 runs of one level make
+// one run of the next), so every element is only ever moved by
+// sequential passes over memory, O(log n / log 16) times.
+// The best elements of all of the runs are merged in bulk into
+// a sorted deletion buffer, and removing takes the better of
+// the insertion heap top and the deletion buffer end.
+// Unlike PriorityQueue there is no value index, so there are
+// no handles or updates, and equal elements are all kept.
+// Ordering follows PriorityQueue: with std::less the greatest
+// element is on the top.
+//***************************************************************
+
+#ifndef SEQUENCE_HEAP_H
+#define SEQUENCE_HEAP_H
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+template <class T, class Compare = std::less<T>>
+class SequenceHeap
+{
+public:
+	// Constructor. 'bufferSize' is the size of the insertion heap and of the deletion buffer,
+	// they should fit into the cache together.
+	SequenceHeap(size_t bufferSize = 4096, const Compare& comp = Compare());
+
+	// Check whether the queue has no elements.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of elements in the queue.
+	size_t Size() const;
+
+	// Add an element to the queue.
+	// Executes in O(log m + log n / log 16) amortized time, m being the buffer size.
+	void Add(const T& e);
+	void Add(T&& e);
+
+	// Remove the element from the queue that has the highest priority, and move it out.
+	// Executes in O(log m + log n / log 16) amortized time.
+	T Remove();
+
+	// Peek, which returns the highest - priority element but does not modify the queue.
+	// Executes in O(1) amortized time.
+	const T& Peek() const;
+
+	// Clears everything in the queue
+	void Clear();
+
+private:
+	// Runs of a level that are merged into one run of the next level
+	static const size_t MERGE_WAYS = 16;
+
+	// A run, sorted so that the best element is at the back
+	typedef std::vector<T> Run;
+
+	// Sorts the insertion heap, together with the deletion buffer, into a new run.
+	void Flush();
+	void AddRun(Run&& run, size_t level);
+	// Merges the runs into a single one, moving the elements out of them.
+	Run MergeRuns(std::vector<Run>& runs, size_t maxCount, bool takeAll) const;
+	// Fills the deletion buffer with the best elements of the runs if it is empty. This doesn't
+	// change the contents of the queue, so the const peek may call it as well.
+	void Refill() const;
+	// Whether the top of the insertion heap is better than anything in the deletion buffer.
+	bool InsertionTopFirst() const;
+
+private:
+	// Heap ordered by mComp, the best element is at the front
+	std::vector<T> mInsertion;
+	// Sorted, the best element is at the back. Everything in it is at least as good as
+	// everything in the runs.
+	mutable Run mDeletion;
+	// Runs of every level
+	mutable std::vector<std::vector<Run>> mLevels;
+	size_t mBufferSize;
+	size_t mSize;
+	Compare mComp;
+};
+
+template<class T, class Compare>
+const size_t SequenceHeap<T, Compare>::MERGE_WAYS;
+
+template<class T, class Compare>
+inline SequenceHeap<T, Compare>::SequenceHeap(size_t bufferSize, const Compare& comp)
+	: mBufferSize(std::max(bufferSize, (size_t)1))
+	, mSize(0)
+	, mComp(comp)
+{
+	mInsertion.reserve(mBufferSize);
+}
+
+template<class T, class Compare>
+inline typename SequenceHeap<T, Compare>::Run SequenceHeap<T, Compare>::MergeRuns(std::vector<Run>& runs, size_t maxCount, bool takeAll) const
+{
+	// Heap of the runs by their back (best) elements
+	std::vector<size_t> heads;
+	for (size_t i = 0; i < runs.size(); ++i)
+	{
+		if (!runs[i].empty())
+			heads.push_back(i);
+	}
+	auto headComp = [&](size_t a, size_t b) { return mComp(runs[a].back(), runs[b].back()); };
+	std::make_heap(heads.begin(), heads.end(), headComp);
+
+	// Take the best elements in order, from the backs of the runs
+	Run merged;
+	if (takeAll)
+	{
+		size_t total = 0;
+		for (const Run& run : runs)
+			total += run.size();
+		maxCount = total;
+	}
+	merged.reserve(maxCount);
+	while (!heads.empty() && merged.size() < maxCount)
+	{
+		std::pop_heap(heads.begin(), heads.end(), headComp);
+		Run& run = runs[heads.back()];
+		merged.push_back(std::move(run.back()));
+		run.pop_back();
+		if (run.empty())
+			heads.pop_back();
+		else
+			std::push_heap(heads.begin(), heads.end(), headComp);
+	}
+
+	// The best one went in first, but it has to be at the back
+	std::reverse(merged.begin(), merged.end());
+	return merged;
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::AddRun(Run&& run, size_t level)
+{
+	if (level == mLevels.size())
+		mLevels.emplace_back();
+	mLevels[level].push_back(std::move(run));
+
+	// A full level becomes a single run of the next one
+	if (mLevels[level].size() == MERGE_WAYS)
+	{
+		Run merged = MergeRuns(mLevels[level], 0, true);
+		mLevels[level].clear();
+		AddRun(std::move(merged), level + 1);
+	}
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::Flush()
+{
+	// Sorted ascending by mComp puts the best element at the back
+	std::sort_heap(mInsertion.begin(), mInsertion.end(), mComp);
+
+	// The new run may have better elements than the ones in the deletion buffer,
+	// so the buffer goes back into the runs along with them
+	Run run;
+	run.reserve(mInsertion.size() + mDeletion.size());
+	std::merge(std::make_move_iterator(mInsertion.begin()), std::make_move_iterator(mInsertion.end()),
+		std::make_move_iterator(mDeletion.begin()), std::make_move_iterator(mDeletion.end()),
+		std::back_inserter(run), mComp);
+	mInsertion.clear();
+	mDeletion.clear();
+	AddRun(std::move(run), 0);
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::Refill() const
+{
+	if (!mDeletion.empty())
+		return;
+
+	// Gather the runs of all of the levels and merge the best of them
+	std::vector<Run> runs;
+	std::vector<std::pair<size_t, size_t>> origins;
+	for (size_t level = 0; level < mLevels.size(); ++level)
+	{
+		for (size_t i = 0; i < mLevels[level].size(); ++i)
+		{
+			runs.push_back(std::move(mLevels[level][i]));
+			origins.push_back(std::make_pair(level, i));
+		}
+	}
+	if (runs.empty())
+		return;
+	mDeletion = MergeRuns(runs, mBufferSize, false);
+
+	// Put what is left of the runs back, without the empty ones
+	for (size_t i = 0; i < runs.size(); ++i)
+		mLevels[origins[i].first][origins[i].second] = std::move(runs[i]);
+	for (std::vector<Run>& level : mLevels)
+		level.erase(std::remove_if(level.begin(), level.end(), [](const Run& run) { return run.empty(); }), level.end());
+}
+
+template<class T, class Compare>
+inline bool SequenceHeap<T, Compare>::InsertionTopFirst() const
+{
+	if (mInsertion.empty())
+		return false;
+	return (mDeletion.empty() || mComp(mDeletion.back(), mInsertion.front()));
+}
+
+template<class T, class Compare>
+inline bool SequenceHeap<T, Compare>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class T, class Compare>
+inline size_t SequenceHeap<T, Compare>::Size() const
+{
+	return mSize;
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::Add(const T& e)
+{
+	Add(T(e));
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::Add(T&& e)
+{
+	if (mInsertion.size() == mBufferSize)
+		Flush();
+
+	mInsertion.push_back(std::move(e));
+	std::push_heap(mInsertion.begin(), mInsertion.end(), mComp);
+	++mSize;
+}
+
+template<class T, class Compare>
+inline T SequenceHeap<T, Compare>::Remove()
+{
+	// Return early if there are no elements
+	if (mSize == 0)
+		return T();
+
+	--mSize;
+	Refill();
+	if (InsertionTopFirst())
+	{
+		std::pop_heap(mInsertion.begin(), mInsertion.end(), mComp);
+		T ret = std::move(mInsertion.back());
+		mInsertion.pop_back();
+		return ret;
+	}
+
+	T ret = std::move(mDeletion.back());
+	mDeletion.pop_back();
+	return ret;
+}
+
+template<class T, class Compare>
+inline const T& SequenceHeap<T, Compare>::Peek() const
+{
+	Refill();
+	return InsertionTopFirst() ? mInsertion.front() : mDeletion.back();
+}
+
+template<class T, class Compare>
+inline void SequenceHeap<T, Compare>::Clear()
+{
+	mInsertion.clear();
+	mDeletion.clear();
+	mLevels.clear();
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,131 @@
+//***************************************************************
+// SlotTable.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Slot bookkeeping shared by the queues that hand out handles
+// to their elements. Every element occupies a slot that stays
+// the same while the element is in the queue, and freed slots
+// are reused. Each slot has a generation that is bumped when
+// the slot is freed, so a handle that remembers the generation
+// it was made with knows when its element is gone. The slots
+// are also indexed by the hashes of their elements. The
+// elements themselves stay with the queue, which compares them
+// when a slot is looked up.
+//***************************************************************
+
+#ifndef SLOT_TABLE_H
+#define SLOT_TABLE_H
+
+#include <vector>
+#include <cstddef>
+#include "FlatHashIndex.h"
+
+template<class Slot>
+class SlotTable
+{
+public:
+	static const Slot NO_SLOT = ~Slot(0);
+
+	// Number of slots created so far. The arrays the queue keeps per slot have to be this long.
+	size_t GetSlotCount() const;
+
+	// Reserve space for 'count' slots.
+	void Reserve(size_t count);
+
+	// Returns a free slot, reusing the freed ones first. A new slot is the one at
+	// the previous GetSlotCount(), the queue has to append its own data for it.
+	Slot Allocate();
+
+	// Unindexes the slot and makes it free. The handles to it become invalid.
+	void Free(Slot slot);
+
+	// Generation of the slot, it changes every time the slot is freed.
+	unsigned int GetGeneration(Slot slot) const;
+
+	// Indexes the slot under the hash of its element. The slot must not be indexed already.
+	void Index(Slot slot, size_t hash);
+
+	// Removes the slot from the index, e.g. before the value of its element changes.
+	void Unindex(Slot slot);
+
+	// Returns the slot with the given hash for which 'equals(slot)' is true, or NO_SLOT if there is none.
+	// Executes in O(1) time on average.
+	template<class Equals>
+	Slot Find(size_t hash, Equals equals) const;
+
+private:
+	// Bumped every time a slot is freed
+	std::vector<unsigned int> mGenerations;
+	// Hash each slot is indexed under
+	std::vector<size_t> mHashes;
+	std::vector<Slot> mFreeSlots;
+	FlatHashIndex mHashToSlot;
+};
+
+template<class Slot>
+const Slot SlotTable<Slot>::NO_SLOT;
+
+template<class Slot>
+inline size_t SlotTable<Slot>::GetSlotCount() const
+{
+	return mGenerations.size();
+}
+
+template<class Slot>
+inline void SlotTable<Slot>::Reserve(size_t count)
+{
+	mGenerations.reserve(count);
+	mHashes.reserve(count);
+	mHashToSlot.Reserve(count);
+}
+
+template<class Slot>
+inline Slot SlotTable<Slot>::Allocate()
+{
+	if (mFreeSlots.empty())
+	{
+		mGenerations.push_back(0);
+		mHashes.push_back(0);
+		return (Slot)(mGenerations.size() - 1);
+	}
+
+	Slot slot = mFreeSlots.back();
+	mFreeSlots.pop_back();
+	return slot;
+}
+
+template<class Slot>
+inline void SlotTable<Slot>::Free(Slot slot)
+{
+	mHashToSlot.Erase(mHashes[slot], slot);
+	++mGenerations[slot];
+	mFreeSlots.push_back(slot);
+}
+
+template<class Slot>
+inline unsigned int SlotTable<Slot>::GetGeneration(Slot slot) const
+{
+	return mGenerations[slot];
+}
+
+template<class Slot>
+inline void SlotTable<Slot>::Index(Slot slot, size_t hash)
+{
+	mHashes[slot] = hash;
+	mHashToSlot.Insert(hash, slot);
+}
+
+template<class Slot>
+inline void SlotTable<Slot>::Unindex(Slot slot)
+{
+	mHashToSlot.Erase(mHashes[slot], slot);
+}
+
+template<class Slot>
+template<class Equals>
+inline Slot SlotTable<Slot>::Find(size_t hash, Equals equals) const
+{
+	unsigned int slot = mHashToSlot.Find(hash, equals);
+	return (slot == FlatHashIndex::NOT_FOUND) ? NO_SLOT : (Slot)slot;
+}
+
+#endif
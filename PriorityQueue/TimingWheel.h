@@ -0,0 +1,558 @@
+//***************************************************************
+// TimingWheel.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Hierarchical timing wheel, an alternative to a priority
+// queue of expiration times for timers. Every level has 64
+// slots, a slot of level L spans 64^L ticks, and a timer goes
+// into the lowest level that can tell its expiration apart from
+// the current time. Adding, cancelling and rescheduling a timer
+// are O(1) linked list operations, with no comparisons at all,
+// and a timer is moved down a level at most once per level
+// before it fires, so timers that are cancelled early (most of
+// them, usually) cost next to nothing. Advancing the time
+// collects all of the timers that expired on the way, and jumps
+// straight over the empty slots with the help of a bitmap per
+// level, so large jumps are cheap as well.
+// Timers are dense integer ids and expiration times are in
+// ticks, same as BucketQueue. Within a tick the timers fire in
+// no particular order. Peek and Remove give the timer that
+// expires first, for when the wheel stands in for a queue, but
+// they scan the first non-empty slot, so Advance is the way to
+// collect the expired timers.
+//***************************************************************
+
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+#include <limits>
+#include <cassert>
+#include <cstddef>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+template <class Time = unsigned long long>
+class TimingWheel
+{
+	static_assert(std::numeric_limits<Time>::is_integer && !std::numeric_limits<Time>::is_signed,
+		"TimingWheel needs an unsigned integer time type.");
+
+public:
+	// Refers to one timer in the wheel. Stays valid until the timer fires or is cancelled.
+	// Handles are cheap to copy and any number of them may exist at once.
+	class ElementHandle
+	{
+		friend class TimingWheel<Time>;
+
+	public:
+		// Creates a handle that doesn't refer to any timer.
+		ElementHandle() : mOwnerPt(nullptr), mId(0), mGeneration(0) {}
+
+		// Check whether the timer this handle refers to is still pending.
+		bool IsValid() const { return (mOwnerPt && mOwnerPt->mGenerations[mId] == mGeneration); }
+
+		// Returns the id this handle refers to.
+		unsigned int GetId() const { return mId; }
+
+		// Returns the expiration time of the timer this handle refers to. The handle must be valid.
+		const Time& GetExpiration() const { return mOwnerPt->mExpirations[mId]; }
+
+		// Reschedules the timer. Returns true if successful.
+		// Executes in O(1) time.
+		bool Update(const Time& expiration) { return (IsValid() && mOwnerPt->Update(mId, expiration)); }
+
+	private:
+		ElementHandle(TimingWheel<Time> *ownerPt, unsigned int id)
+			: mOwnerPt(ownerPt), mId(id), mGeneration(ownerPt->mGenerations[id]) {}
+		TimingWheel<Time> *mOwnerPt;
+		unsigned int mId;
+		unsigned int mGeneration;
+	};
+
+public:
+	// Constructor. 'now' is the starting time.
+	TimingWheel(Time now = 0, unsigned int idCount = 0);
+
+	// Reserves space for ids in the range [0, idCount). Larger ids are still
+	// accepted, the arrays simply grow when they are added.
+	void Reserve(unsigned int idCount);
+
+	// Check whether there are no pending timers.
+	// Executes in O(1) time.
+	bool Empty() const;
+
+	// Number of pending timers.
+	size_t Size() const;
+
+	// Current time of the wheel.
+	const Time& GetTime() const;
+
+	// Check whether the timer is pending.
+	// Executes in O(1) time.
+	bool Contains(unsigned int id) const;
+
+	// Add a timer that expires at the given time and return the handle to it. A timer that has
+	// already expired fires on the next Advance. If the timer is already pending, the handle to it
+	// is returned and its expiration is kept.
+	// Executes in O(1) time.
+	ElementHandle Add(unsigned int id, const Time& expiration);
+
+	// Moves the time forward to 'now', which may not be in the past, and appends the ids of all of
+	// the timers that expired until then to 'expired'. Returns the number of the expired timers.
+	// Executes in O(k) amortized time for k expired timers (plus a constant per visited slot).
+	size_t Advance(const Time& now, std::vector<unsigned int>& expired);
+
+	// Returns the expiration time of a pending timer.
+	// Executes in O(1) time.
+	const Time& GetExpiration(unsigned int id) const;
+
+	// Returns the id of the timer that expires first, without moving the time. The wheel must not be empty.
+	// Executes in O(k) time for k timers in the first non-empty slot.
+	unsigned int Peek() const;
+
+	// Returns the expiration time of the timer that expires first. The wheel must not be empty.
+	// Executes in O(k) time for k timers in the first non-empty slot.
+	const Time& PeekExpiration() const;
+
+	// Cancels the timer that expires first and returns its id. The time doesn't move, so the
+	// timer doesn't count as fired. The wheel must not be empty.
+	// Executes in O(k) time for k timers in the first non-empty slot.
+	unsigned int Remove();
+
+	// Reschedules a pending timer, to any time. Returns false if the timer is not pending.
+	// Executes in O(1) time.
+	bool Update(unsigned int id, const Time& expiration);
+
+	// Cancels a pending timer. Returns false if the timer is not pending.
+	// Executes in O(1) time.
+	bool Erase(unsigned int id);
+
+	// Cancels the timer the handle refers to. Returns false if the handle is not valid.
+	// Executes in O(1) time.
+	bool Erase(const ElementHandle& handle);
+
+	// Get a handle to a pending timer. The handle is not valid if the timer is not pending.
+	ElementHandle GetElementHandle(unsigned int id);
+
+	// Cancels all of the timers. Only touches the pending ones.
+	void Clear();
+
+private:
+	static const unsigned int LEVEL_BITS = 6;
+	static const unsigned int SLOTS = 1u << LEVEL_BITS;
+	static const unsigned int SLOT_MASK = SLOTS - 1;
+	static const unsigned int LEVELS = (std::numeric_limits<Time>::digits + LEVEL_BITS - 1) / LEVEL_BITS;
+	// Bucket of the timers that had expired already when they were added
+	static const unsigned int DUE = LEVELS * SLOTS;
+	// Marks the end of a bucket list
+	static const unsigned int NONE = ~0u;
+	// Stored as the previous id of the ids that are not pending
+	static const unsigned int NOT_IN_QUEUE = ~0u - 1;
+
+	static unsigned int HighestBit(unsigned long long bits);
+	static unsigned int LowestBit(unsigned long long bits);
+	// Links the timer into the bucket for its expiration, relative to the current time.
+	void Place(unsigned int id);
+	void Link(unsigned int id, unsigned int bucket);
+	void Unlink(unsigned int id);
+	// Finds the first non-empty slot after the current time. Returns false if there is none.
+	bool GetNextSlot(unsigned int *level, unsigned int *slot) const;
+	// Finds the start of the first non-empty slot after the current time. Returns false if there is none.
+	bool GetNextStop(Time *stop) const;
+	// Returns the pending timer with the earliest expiration, the first one found among equals.
+	unsigned int FindEarliest() const;
+	// Moves the timers of a slot down to the lower levels.
+	void Cascade(unsigned int bucket);
+	// Takes all of the timers out of a bucket and appends them to 'expired'.
+	void Expire(unsigned int bucket, std::vector<unsigned int>& expired);
+
+private:
+	// First id in each bucket, level by level
+	std::vector<unsigned int> mHeads;
+	// Bit per non-empty slot of every level
+	unsigned long long mOccupied[LEVELS];
+	std::vector<unsigned int> mNext;
+	std::vector<unsigned int> mPrev;
+	std::vector<unsigned int> mBuckets;
+	std::vector<Time> mExpirations;
+	// Bumped every time a timer fires or is cancelled, so that the handles to it become invalid
+	std::vector<unsigned int> mGenerations;
+	Time mNow;
+	size_t mSize;
+};
+
+template<class Time>
+const unsigned int TimingWheel<Time>::LEVEL_BITS;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::SLOTS;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::SLOT_MASK;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::LEVELS;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::DUE;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::NONE;
+
+template<class Time>
+const unsigned int TimingWheel<Time>::NOT_IN_QUEUE;
+
+template<class Time>
+inline TimingWheel<Time>::TimingWheel(Time now, unsigned int idCount)
+	: mHeads(LEVELS * SLOTS + 1, NONE)
+	, mNow(now)
+	, mSize(0)
+{
+	for (unsigned int level = 0; level < LEVELS; ++level)
+		mOccupied[level] = 0;
+	Reserve(idCount);
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Reserve(unsigned int idCount)
+{
+	if (idCount > mPrev.size())
+	{
+		mNext.resize(idCount);
+		mPrev.resize(idCount, NOT_IN_QUEUE);
+		mBuckets.resize(idCount);
+		mExpirations.resize(idCount);
+		mGenerations.resize(idCount, 0);
+	}
+}
+
+template<class Time>
+inline unsigned int TimingWheel<Time>::HighestBit(unsigned long long bits)
+{
+#if defined(__GNUC__)
+	return 63 - __builtin_clzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return index;
+#else
+	unsigned int index = 0;
+	while (bits >>= 1) ++index;
+	return index;
+#endif
+}
+
+template<class Time>
+inline unsigned int TimingWheel<Time>::LowestBit(unsigned long long bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return index;
+#else
+	unsigned int index = 0;
+	while (!(bits & 1)) { ++index; bits >>= 1; }
+	return index;
+#endif
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Place(unsigned int id)
+{
+	const Time& expiration = mExpirations[id];
+	if (expiration <= mNow)
+	{
+		Link(id, DUE);
+		return;
+	}
+
+	// The highest bit in which the expiration differs from now picks the level,
+	// the digit of the expiration on that level picks the slot.
+	unsigned int level = HighestBit((unsigned long long)(expiration ^ mNow)) / LEVEL_BITS;
+	unsigned int slot = (unsigned int)((unsigned long long)expiration >> (level * LEVEL_BITS)) & SLOT_MASK;
+	Link(id, level * SLOTS + slot);
+	mOccupied[level] |= 1ull << slot;
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Link(unsigned int id, unsigned int bucket)
+{
+	// Push to the front of the bucket list
+	unsigned int& head = mHeads[bucket];
+	mBuckets[id] = bucket;
+	mNext[id] = head;
+	mPrev[id] = NONE;
+	if (head != NONE)
+		mPrev[head] = id;
+	head = id;
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Unlink(unsigned int id)
+{
+	unsigned int bucket = mBuckets[id];
+	if (mPrev[id] == NONE)
+	{
+		mHeads[bucket] = mNext[id];
+		// Clear the bit of the slot if this was its last timer
+		if (mNext[id] == NONE && bucket != DUE)
+			mOccupied[bucket / SLOTS] &= ~(1ull << (bucket & SLOT_MASK));
+	}
+	else
+		mNext[mPrev[id]] = mNext[id];
+
+	if (mNext[id] != NONE)
+		mPrev[mNext[id]] = mPrev[id];
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::GetNextSlot(unsigned int *level, unsigned int *slot) const
+{
+	// The occupied slots of a level are always ahead of the current one, and anything
+	// on a level is later than everything on the levels below, so the first level
+	// with an occupied slot has the next stop.
+	unsigned long long now = (unsigned long long)mNow;
+	for (unsigned int l = 0; l < LEVELS; ++l)
+	{
+		unsigned int current = (unsigned int)(now >> (l * LEVEL_BITS)) & SLOT_MASK;
+		unsigned long long ahead = (current == SLOT_MASK) ? 0 : (mOccupied[l] & (~0ull << (current + 1)));
+		if (ahead == 0)
+			continue;
+
+		*level = l;
+		*slot = LowestBit(ahead);
+		return true;
+	}
+	return false;
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::GetNextStop(Time *stop) const
+{
+	unsigned int level, slot;
+	if (!GetNextSlot(&level, &slot))
+		return false;
+
+	unsigned int shift = level * LEVEL_BITS;
+	unsigned int upperShift = shift + LEVEL_BITS;
+	unsigned long long now = (unsigned long long)mNow;
+	unsigned long long base = (upperShift >= 64) ? 0 : ((now >> upperShift) << upperShift);
+	*stop = (Time)(base | ((unsigned long long)slot << shift));
+	return true;
+}
+
+template<class Time>
+inline unsigned int TimingWheel<Time>::FindEarliest() const
+{
+	// The timers that are due come before everything else. Otherwise the earliest one is in
+	// the slot of the next stop, but the timers of a higher level slot are not sorted.
+	unsigned int bucket = DUE;
+	if (mHeads[DUE] == NONE)
+	{
+		unsigned int level = 0, slot = 0;
+		GetNextSlot(&level, &slot);
+		bucket = level * SLOTS + slot;
+	}
+
+	unsigned int earliest = mHeads[bucket];
+	for (unsigned int id = mNext[earliest]; id != NONE; id = mNext[id])
+		if (mExpirations[id] < mExpirations[earliest])
+			earliest = id;
+	return earliest;
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Cascade(unsigned int bucket)
+{
+	// Detach the whole list, then place its timers again relative to the new time
+	unsigned int id = mHeads[bucket];
+	mHeads[bucket] = NONE;
+	mOccupied[bucket / SLOTS] &= ~(1ull << (bucket & SLOT_MASK));
+	while (id != NONE)
+	{
+		unsigned int next = mNext[id];
+		Place(id);
+		id = next;
+	}
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Expire(unsigned int bucket, std::vector<unsigned int>& expired)
+{
+	unsigned int id = mHeads[bucket];
+	mHeads[bucket] = NONE;
+	if (bucket != DUE)
+		mOccupied[bucket / SLOTS] &= ~(1ull << (bucket & SLOT_MASK));
+	while (id != NONE)
+	{
+		expired.push_back(id);
+		mPrev[id] = NOT_IN_QUEUE;
+		++mGenerations[id];
+		--mSize;
+		id = mNext[id];
+	}
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class Time>
+inline size_t TimingWheel<Time>::Size() const
+{
+	return mSize;
+}
+
+template<class Time>
+inline const Time& TimingWheel<Time>::GetTime() const
+{
+	return mNow;
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::Contains(unsigned int id) const
+{
+	return (id < mPrev.size() && mPrev[id] != NOT_IN_QUEUE);
+}
+
+template<class Time>
+inline typename TimingWheel<Time>::ElementHandle TimingWheel<Time>::Add(unsigned int id, const Time& expiration)
+{
+	// Return early if the timer is already pending
+	if (Contains(id))
+		return ElementHandle(this, id);
+
+	if (id >= mPrev.size())
+		Reserve(id + 1);
+
+	mExpirations[id] = expiration;
+	Place(id);
+	++mSize;
+	return ElementHandle(this, id);
+}
+
+template<class Time>
+inline size_t TimingWheel<Time>::Advance(const Time& now, std::vector<unsigned int>& expired)
+{
+	assert(now >= mNow);
+	size_t oldCount = expired.size();
+	Expire(DUE, expired);
+
+	// Stop only at the slots that have something in them
+	Time stop;
+	while (GetNextStop(&stop) && stop <= now)
+	{
+		mNow = stop;
+
+		// Entering a slot of a higher level moves its timers down, the higher levels go
+		// first since their timers may land in the slot of a lower one that starts now
+		for (unsigned int level = LEVELS - 1; level > 0; --level)
+		{
+			unsigned int shift = level * LEVEL_BITS;
+			if (((unsigned long long)mNow & ((1ull << shift) - 1)) == 0)
+				Cascade(level * SLOTS + ((unsigned int)((unsigned long long)mNow >> shift) & SLOT_MASK));
+		}
+
+		// The ones in the first level slot of now have expired, and so have the cascaded
+		// ones that expire exactly now
+		Expire((unsigned int)mNow & SLOT_MASK, expired);
+		Expire(DUE, expired);
+	}
+	mNow = now;
+	return expired.size() - oldCount;
+}
+
+template<class Time>
+inline const Time& TimingWheel<Time>::GetExpiration(unsigned int id) const
+{
+	return mExpirations[id];
+}
+
+template<class Time>
+inline unsigned int TimingWheel<Time>::Peek() const
+{
+	assert(!Empty() && "Peek on an empty wheel.");
+	return FindEarliest();
+}
+
+template<class Time>
+inline const Time& TimingWheel<Time>::PeekExpiration() const
+{
+	assert(!Empty() && "Peek on an empty wheel.");
+	return mExpirations[FindEarliest()];
+}
+
+template<class Time>
+inline unsigned int TimingWheel<Time>::Remove()
+{
+	assert(!Empty() && "Remove on an empty wheel.");
+	unsigned int ret = FindEarliest();
+	Erase(ret);
+	return ret;
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::Update(unsigned int id, const Time& expiration)
+{
+	if (!Contains(id))
+		return false;
+
+	Unlink(id);
+	mExpirations[id] = expiration;
+	Place(id);
+	return true;
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::Erase(unsigned int id)
+{
+	if (!Contains(id))
+		return false;
+
+	Unlink(id);
+	mPrev[id] = NOT_IN_QUEUE;
+	++mGenerations[id];
+	--mSize;
+	return true;
+}
+
+template<class Time>
+inline bool TimingWheel<Time>::Erase(const ElementHandle& handle)
+{
+	if (handle.mOwnerPt != this || !handle.IsValid())
+		return false;
+	return Erase(handle.mId);
+}
+
+template<class Time>
+inline typename TimingWheel<Time>::ElementHandle TimingWheel<Time>::GetElementHandle(unsigned int id)
+{
+	if (!Contains(id))
+		return ElementHandle();
+	return ElementHandle(this, id);
+}
+
+template<class Time>
+inline void TimingWheel<Time>::Clear()
+{
+	for (unsigned int& head : mHeads)
+	{
+		while (head != NONE)
+		{
+			unsigned int id = head;
+			head = mNext[id];
+			mPrev[id] = NOT_IN_QUEUE;
+			++mGenerations[id];
+		}
+	}
+	for (unsigned int level = 0; level < LEVELS; ++level)
+		mOccupied[level] = 0;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,226 @@
+//***************************************************************
+// TopK.h by Bojan Lovrovic (C) 2019 All Rights Reserved.
+//
+// Selects the K greatest elements (by Compare, same as with
+// PriorityQueue) out of a stream of any length. The elements
+// are kept in a fixed array inside the object, arranged as a
+// heap with the K-th greatest element, the threshold, on the
+// top, so nothing is ever allocated and a rejected element
+// costs a single comparison. AddRange tests whole blocks of
+// elements against the threshold without branching, which
+// the compiler turns into SIMD code for the arithmetic types.
+// For the smallest elements (e.g. the nearest neighbours by
+// distance) use std::greater.
+//***************************************************************
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <functional>
+
+template <class T, unsigned int K, class Compare = std::less<T>>
+class TopK
+{
+	static_assert(K >= 1, "TopK needs room for at least one element.");
+
+public:
+	// Default constructor
+	TopK();
+
+	// Constructor with a comparison function object
+	TopK(const Compare& comp);
+
+	// Check whether nothing was selected yet.
+	bool Empty() const;
+
+	// Check whether K elements were selected, from then on the threshold is in effect.
+	bool IsFull() const;
+
+	// Number of the selected elements, at most K.
+	size_t Size() const;
+
+	// Returns the smallest of the selected elements, the one the new elements need to beat
+	// once the selection is full.
+	// Executes in O(1) time.
+	const T& GetThreshold() const;
+
+	// Offer an element. Returns true if it was selected, possibly evicting the smallest one.
+	// Executes in O(1) time if the element is rejected and in O(log K) time otherwise.
+	bool Add(const T& e);
+
+	// Offer 'count' elements from 'data'. The blocks of elements that don't beat the
+	// threshold are rejected all at once.
+	void AddRange(const T *data, size_t count);
+
+	// Returns the selected element at 'index', in no particular order.
+	const T& Get(size_t index) const;
+
+	// Writes the selected elements to 'out' from the greatest to the smallest.
+	void GetSorted(std::vector<T> *out) const;
+
+	// Clears the selection
+	void Clear();
+
+private:
+	static const size_t BLOCK_SIZE = 16;
+
+	// The smaller element goes above, so that the smallest one is on the top of the heap.
+	bool Above(const T& a, const T& b) const;
+	void BubbleUp(size_t ePos);
+	void BubbleDown(size_t ePos);
+
+private:
+	std::array<T, K> mData;
+	size_t mSize;
+	Compare mComp;
+};
+
+template<class T, unsigned int K, class Compare>
+const size_t TopK<T, K, Compare>::BLOCK_SIZE;
+
+template<class T, unsigned int K, class Compare>
+inline TopK<T, K, Compare>::TopK()
+	: TopK<T, K, Compare>(Compare())
+{
+
+}
+
+template<class T, unsigned int K, class Compare>
+inline TopK<T, K, Compare>::TopK(const Compare& comp)
+	: mSize(0)
+	, mComp(comp)
+{
+
+}
+
+template<class T, unsigned int K, class Compare>
+inline bool TopK<T, K, Compare>::Above(const T& a, const T& b) const
+{
+	return mComp(a, b);
+}
+
+template<class T, unsigned int K, class Compare>
+inline void TopK<T, K, Compare>::BubbleUp(size_t ePos)
+{
+	while (ePos != 0)
+	{
+		size_t pPos = (ePos - 1) / 2;
+		if (!Above(mData[ePos], mData[pPos]))
+			break;
+		std::swap(mData[ePos], mData[pPos]);
+		ePos = pPos;
+	}
+}
+
+template<class T, unsigned int K, class Compare>
+inline void TopK<T, K, Compare>::BubbleDown(size_t ePos)
+{
+	while (true)
+	{
+		size_t cPos = ePos * 2 + 1;
+		if (cPos >= mSize)
+			break;
+		if (cPos + 1 < mSize && Above(mData[cPos + 1], mData[cPos]))
+			++cPos;
+		if (!Above(mData[cPos], mData[ePos]))
+			break;
+		std::swap(mData[ePos], mData[cPos]);
+		ePos = cPos;
+	}
+}
+
+template<class T, unsigned int K, class Compare>
+inline bool TopK<T, K, Compare>::Empty() const
+{
+	return (mSize == 0);
+}
+
+template<class T, unsigned int K, class Compare>
+inline bool TopK<T, K, Compare>::IsFull() const
+{
+	return (mSize == K);
+}
+
+template<class T, unsigned int K, class Compare>
+inline size_t TopK<T, K, Compare>::Size() const
+{
+	return mSize;
+}
+
+template<class T, unsigned int K, class Compare>
+inline const T& TopK<T, K, Compare>::GetThreshold() const
+{
+	return mData[0];
+}
+
+template<class T, unsigned int K, class Compare>
+inline bool TopK<T, K, Compare>::Add(const T& e)
+{
+	if (mSize < K)
+	{
+		mData[mSize] = e;
+		BubbleUp(mSize++);
+		return true;
+	}
+
+	// Return early if the element doesn't beat the threshold
+	if (!mComp(mData[0], e))
+		return false;
+
+	// Replace the smallest element and sink the new one down
+	mData[0] = e;
+	BubbleDown(0);
+	return true;
+}
+
+template<class T, unsigned int K, class Compare>
+inline void TopK<T, K, Compare>::AddRange(const T *data, size_t count)
+{
+	size_t i = 0;
+	for (; i < count && mSize < K; ++i)
+		Add(data[i]);
+
+	for (; i + BLOCK_SIZE <= count; i += BLOCK_SIZE)
+	{
+		// Check the whole block against the threshold without branching, so that the loop vectorizes.
+		const T threshold = mData[0];
+		unsigned int anyAbove = 0;
+		for (size_t j = 0; j < BLOCK_SIZE; ++j)
+			anyAbove |= (unsigned int)mComp(threshold, data[i + j]);
+		if (!anyAbove)
+			continue;
+
+		for (size_t j = 0; j < BLOCK_SIZE; ++j)
+			Add(data[i + j]);
+	}
+
+	for (; i < count; ++i)
+		Add(data[i]);
+}
+
+template<class T, unsigned int K, class Compare>
+inline const T& TopK<T, K, Compare>::Get(size_t index) const
+{
+	return mData[index];
+}
+
+template<class T, unsigned int K, class Compare>
+inline void TopK<T, K, Compare>::GetSorted(std::vector<T> *out) const
+{
+	out->assign(mData.begin(), mData.begin() + mSize);
+	Compare comp = mComp;
+	std::sort(out->begin(), out->end(), [&comp](const T& a, const T& b) { return comp(b, a); });
+}
+
+template<class T, unsigned int K, class Compare>
+inline void TopK<T, K, Compare>::Clear()
+{
+	mSize = 0;
+}
+
+#endif
@@ -9,7 +9,10 @@
 #define KDTREE_H
 
 #include <array>
+#include <utility>
+#include <functional>
 #include "BinaryTree.h"
+#include "../PriorityQueue/TopK.h"
 
 template<class Type, int k>
 class KDTree : public BinaryTree<std::array<Type, k>>
@@ -25,6 +28,12 @@ public:
 	// Time complexity is O(log n).
 	unsigned int FindNearestNeighbourIndex(const std::array<Type, k> &point) const;
 
+	// Same as above, but finds the K points that are nearest to the given input point.
+	// outNearest	- (distance squared, node index) pairs of the found points
+	template<unsigned int K>
+	void FindNearestNeighbourIndices(const std::array<Type, k> &point,
+		TopK<std::pair<Type, unsigned int>, K, std::greater<std::pair<Type, unsigned int>>> *outNearest) const;
+
 private:
 	Type GetDistanceSq(const std::array<Type, k> &p1, const std::array<Type, k> &p2) const;
 	unsigned int GetSplittingAxis(unsigned int nodeIndex) const;
@@ -32,6 +41,9 @@ private:
 	unsigned int GetChildIndex(unsigned int nodeIndex, unsigned char side) const;
 	void CreateNode(std::array<Type, k> *data, unsigned int dataElementsNumber, unsigned int nodeIndex);
 	unsigned int NearestNeighbourIndexSearch(unsigned int nodeIndex, const std::array<Type, k> &point) const;
+	template<unsigned int K>
+	void NearestNeighbourIndicesSearch(unsigned int nodeIndex, const std::array<Type, k> &point,
+		TopK<std::pair<Type, unsigned int>, K, std::greater<std::pair<Type, unsigned int>>> *outNearest) const;
 };
 
 // **************************************************************
@@ -114,6 +126,39 @@ inline unsigned int KDTree<Type, k>::NearestNeighbourIndexSearch(unsigned int no
 	return betterNodeI;
 }
 
+template<class Type, int k>
+template<unsigned int K>
+inline void KDTree<Type, k>::FindNearestNeighbourIndices(const std::array<Type, k> &point,
+	TopK<std::pair<Type, unsigned int>, K, std::greater<std::pair<Type, unsigned int>>> *outNearest) const
+{
+	outNearest->Clear();
+	NearestNeighbourIndicesSearch(GetRoot(), point, outNearest);
+}
+
+template<class Type, int k>
+template<unsigned int K>
+inline void KDTree<Type, k>::NearestNeighbourIndicesSearch(unsigned int nodeIndex, const std::array<Type, k> &point,
+	TopK<std::pair<Type, unsigned int>, K, std::greater<std::pair<Type, unsigned int>>> *outNearest) const
+{
+	// Recursion base case
+	if (!IsNode(nodeIndex))
+		return;
+
+	// Offer this node, it's rejected right away if it's farther than the K-th nearest found so far.
+	outNearest->Add(std::make_pair(GetDistanceSq(point, GetElement(nodeIndex)), nodeIndex));
+
+	// Recurse into the side of the point first.
+	unsigned int splittingAxis = GetSplittingAxis(nodeIndex);
+	Type splittingValue = GetElement(nodeIndex)[splittingAxis];
+	unsigned char first = point[splittingAxis] > splittingValue;
+	NearestNeighbourIndicesSearch(GetChildIndex(nodeIndex, first), point, outNearest);
+
+	// The other side can only have nearer points if the splitting plane is nearer than the K-th one.
+	Type distanceOnTheSplittingAxisSq = pow(point[splittingAxis] - splittingValue, 2);
+	if (!outNearest->IsFull() || distanceOnTheSplittingAxisSq < outNearest->GetThreshold().first)
+		NearestNeighbourIndicesSearch(GetChildIndex(nodeIndex, first ^ 1), point, outNearest);
+}
+
 template<class Type, int k>
 inline Type KDTree<Type, k>::GetDistanceSq(const std::array<Type, k> &p1, const std::array<Type, k> &p2) const
 {
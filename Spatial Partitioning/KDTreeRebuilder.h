@@ -0,0 +1,201 @@
+//***************************************************************
+// KDTreeRebuilder.h by Bojan Lovrovic (C) 2016 All Rights Reserved.
+//
+// Rebuilds a KDTree (or a KDTreeMap) on a worker thread and
+// swaps it in once it's ready. Readers keep querying the
+// previously published tree in the meantime, they never wait
+// for the rebuild to finish. The published tree and the one
+// before it form a double buffer: the front slot is an atomic
+// index and every slot counts its readers, so taking a tree is
+// a couple of atomic operations and never takes a lock. Only
+// the worker waits, before it replaces the back slot, for the
+// readers that still hold the tree in it.
+//***************************************************************
+
+#ifndef KDTREE_REBUILDER_H
+#define KDTREE_REBUILDER_H
+
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include "../Async/AsyncWorker.h"
+
+template<class TreeType>
+class KDTreeRebuilder : public AsyncWorker
+{
+public:
+	// Keeps a published tree alive while it's being queried. Should be held only for
+	// the duration of the queries, since the worker can't reuse its slot before it's released.
+	class TreeReader
+	{
+		friend class KDTreeRebuilder<TreeType>;
+
+	public:
+		TreeReader() : mReadersPt(nullptr), mTree(nullptr) {}
+		TreeReader(TreeReader &&other) : mReadersPt(other.mReadersPt), mTree(other.mTree) { other.mReadersPt = nullptr; other.mTree = nullptr; }
+		TreeReader &operator=(TreeReader &&other) { std::swap(mReadersPt, other.mReadersPt); std::swap(mTree, other.mTree); return *this; }
+		~TreeReader() { if (mReadersPt) mReadersPt->fetch_sub(1, std::memory_order_release); }
+
+		// Null before the first rebuild finishes.
+		const TreeType *Get() const { return mTree; }
+		const TreeType *operator->() const { return mTree; }
+		const TreeType &operator*() const { return *mTree; }
+		explicit operator bool() const { return (mTree != nullptr); }
+
+	private:
+		TreeReader(const TreeReader &);
+		TreeReader &operator=(const TreeReader &);
+		TreeReader(std::atomic<unsigned int> *readersPt, const TreeType *tree) : mReadersPt(readersPt), mTree(tree) {}
+		std::atomic<unsigned int> *mReadersPt;
+		const TreeType *mTree;
+	};
+
+public:
+	KDTreeRebuilder();
+	~KDTreeRebuilder();
+
+	// Schedules the rebuild from a copy of the given data. Takes the same arguments as
+	// TreeType::Initialize (points for KDTree, keys and values for KDTreeMap).
+	// Returns immediately. If a rebuild is already running, the new snapshot replaces
+	// any other snapshot that is still waiting and will be built right after it.
+	template<class DataType>
+	void Rebuild(const DataType &data);
+	template<class KeysType, class ValuesType>
+	void Rebuild(const KeysType &keys, const ValuesType &values);
+
+	// Returns the most recently published tree (empty before the first rebuild finishes).
+	// Lock-free. Hold on to the returned reader for the duration of the query.
+	TreeReader GetTree() const;
+
+	// Returns the number of trees published so far.
+	unsigned int GetVersion() const;
+
+private:
+	void Schedule(const std::function<void(TreeType *)> &build);
+	virtual void Work();
+
+	// Double buffer of the trees, mFront is the index of the published one or -1
+	std::unique_ptr<TreeType> mTrees[2];
+	mutable std::atomic<unsigned int> mReaders[2];
+	std::atomic<int> mFront;
+	std::function<void(TreeType *)> mPendingBuild;
+	mutable std::mutex mPendingLock;
+	bool mBuilding;
+	unsigned int mVersion;
+};
+
+// **************************************************************
+//						Definitions
+// **************************************************************
+
+template<class TreeType>
+inline KDTreeRebuilder<TreeType>::KDTreeRebuilder()
+	: mFront(-1)
+	, mBuilding(false)
+	, mVersion(0)
+{
+	mReaders[0].store(0, std::memory_order_relaxed);
+	mReaders[1].store(0, std::memory_order_relaxed);
+}
+
+template<class TreeType>
+inline KDTreeRebuilder<TreeType>::~KDTreeRebuilder()
+{
+	// Work() must not be running once this part of the object is gone.
+	Join();
+}
+
+template<class TreeType>
+template<class DataType>
+inline void KDTreeRebuilder<TreeType>::Rebuild(const DataType &data)
+{
+	// The lambda holds the snapshot.
+	Schedule([data](TreeType *tree) { tree->Initialize(data); });
+}
+
+template<class TreeType>
+template<class KeysType, class ValuesType>
+inline void KDTreeRebuilder<TreeType>::Rebuild(const KeysType &keys, const ValuesType &values)
+{
+	// The lambda holds the snapshot.
+	Schedule([keys, values](TreeType *tree) { tree->Initialize(keys, values); });
+}
+
+template<class TreeType>
+inline typename KDTreeRebuilder<TreeType>::TreeReader KDTreeRebuilder<TreeType>::GetTree() const
+{
+	while (true)
+	{
+		int front = mFront.load(std::memory_order_seq_cst);
+		if (front < 0)
+			return TreeReader();
+
+		// Register as a reader of the slot, then make sure it's still the front one. If it is, the
+		// worker either sees this reader before touching the slot or had already published it.
+		mReaders[front].fetch_add(1, std::memory_order_seq_cst);
+		if (mFront.load(std::memory_order_seq_cst) == front)
+			return TreeReader(&mReaders[front], mTrees[front].get());
+		mReaders[front].fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+template<class TreeType>
+inline unsigned int KDTreeRebuilder<TreeType>::GetVersion() const
+{
+	std::unique_lock<std::mutex> locker(mPendingLock);
+	return mVersion;
+}
+
+template<class TreeType>
+inline void KDTreeRebuilder<TreeType>::Schedule(const std::function<void(TreeType *)> &build)
+{
+	bool assign;
+	{
+		std::unique_lock<std::mutex> locker(mPendingLock);
+		mPendingBuild = build;
+		// Only wake up the worker if it isn't building already, otherwise
+		// it will pick up the pending snapshot on its own.
+		assign = !mBuilding;
+		mBuilding = true;
+	}
+
+	if (assign)
+		Assign(nullptr, 0);
+}
+
+template<class TreeType>
+inline void KDTreeRebuilder<TreeType>::Work()
+{
+	while (true)
+	{
+		std::function<void(TreeType *)> build;
+		{ // Take the latest snapshot or finish if there is none.
+			std::unique_lock<std::mutex> locker(mPendingLock);
+			if (!mPendingBuild)
+			{
+				mBuilding = false;
+				return;
+			}
+			build.swap(mPendingBuild);
+		}
+
+		// Build the new tree aside, the readers may still be using both slots.
+		std::unique_ptr<TreeType> tree(new TreeType());
+		build(tree.get());
+
+		// Wait for the last readers of the back slot to leave, then replace it and publish it.
+		int back = (mFront.load(std::memory_order_relaxed) == 0) ? 1 : 0;
+		while (mReaders[back].load(std::memory_order_seq_cst) != 0)
+			std::this_thread::yield();
+		mTrees[back] = std::move(tree);
+		mFront.store(back, std::memory_order_seq_cst);
+
+		{
+			std::unique_lock<std::mutex> locker(mPendingLock);
+			++mVersion;
+		}
+	}
+}
+
+#endif